@@ -0,0 +1,311 @@
+#include "activity.h"
+#include "fight.h"
+#include "registry.h"
+
+#include <cmath>
+#include <limits>
+
+namespace {
+
+static_assert(NpcRegistry::size <= 8, "type masks are one byte");
+
+constexpr std::uint32_t NoRegion = std::numeric_limits<std::uint32_t>::max();
+constexpr std::size_t DriftBlock = 64;
+
+// Body::asleep_since holds the tick modulo SinceWrap, plus one so that 0 means awake.
+constexpr int SinceWrap = 65535;
+
+constexpr std::array<std::uint8_t, NpcRegistry::size> eaten_by = [] {
+    std::array<std::uint8_t, NpcRegistry::size> result{};
+    for (std::size_t a = 0; a < NpcRegistry::size; ++a)
+        for (std::size_t d = 0; d < NpcRegistry::size; ++d)
+            if (NpcRegistry::eats[a][d])
+                result[d] |= 1 << a;
+    return result;
+}();
+
+std::uint16_t since_code(int tick) {
+    return static_cast<std::uint16_t>(tick % SinceWrap + 1);
+}
+
+// Ticks from the one the body fell asleep at up to, not including, `tick`.
+int ticks_since(const Body& body, int tick) {
+    int since = tick % SinceWrap - (body.asleep_since - 1);
+    return since < 0 ? since + SinceWrap : since;
+}
+
+// Ticks since the last drift tick before `tick`, not including it.
+int ticks_since_drift(int tick, int stride, std::size_t phase) {
+    return static_cast<int>((static_cast<std::uint64_t>(tick) + phase + stride - 1) % stride);
+}
+
+// OR of every cell within `radius` in both directions, done one axis at a time.
+void dilate(std::vector<std::uint8_t>& cells, int nx, int ny, int radius) {
+    std::vector<std::uint8_t> rows(cells.size(), 0);
+    for (int y = 0; y < ny; ++y)
+        for (int x = 0; x < nx; ++x)
+            if (std::uint8_t v = cells[x + y * nx])
+                for (int k = std::max(x - radius, 0); k <= std::min(x + radius, nx - 1); ++k)
+                    rows[k + y * nx] |= v;
+
+    std::fill(cells.begin(), cells.end(), 0);
+    for (int y = 0; y < ny; ++y)
+        for (int x = 0; x < nx; ++x)
+            if (std::uint8_t v = rows[x + y * nx])
+                for (int k = std::max(y - radius, 0); k <= std::min(y + radius, ny - 1); ++k)
+                    cells[x + k * nx] |= v;
+}
+
+}
+
+RegionActivity::RegionActivity(const WorldConfig& config, const SleepConfig& s) : cfg(config), sleep(s) {
+    sleep.region = std::max(sleep.region, 1);
+    sleep.stride = std::clamp(sleep.stride, 1, SinceWrap / 4);
+
+    rx_count = config.map_x / sleep.region + 1;
+    ry_count = config.map_y / sleep.region + 1;
+
+    int reach = NpcRegistry::max_reach + 2 * NpcRegistry::max_speed;
+    radius = (reach + sleep.region - 1) / sleep.region;
+
+    counts.assign(rx_count * ry_count * NpcRegistry::size, 0);
+}
+
+void RegionActivity::rebuild(const std::vector<Body>& bodies) {
+    std::fill(counts.begin(), counts.end(), 0);
+    head.assign(counts.size() / NpcRegistry::size, NoRegion);
+    body_region.assign(bodies.size(), NoRegion);
+    next.assign(bodies.size(), NoRegion);
+    prev.assign(bodies.size(), NoRegion);
+    for (std::size_t i = 0; i < bodies.size(); ++i)
+        relocate(i, bodies[i]);
+    refresh();
+}
+
+void RegionActivity::link(std::uint32_t index, std::uint32_t region) {
+    prev[index] = NoRegion;
+    next[index] = head[region];
+    if (head[region] != NoRegion)
+        prev[head[region]] = index;
+    head[region] = index;
+}
+
+void RegionActivity::unlink(std::uint32_t index, std::uint32_t region) {
+    if (prev[index] != NoRegion)
+        next[prev[index]] = next[index];
+    else
+        head[region] = next[index];
+    if (next[index] != NoRegion)
+        prev[next[index]] = prev[index];
+}
+
+void RegionActivity::relocate(std::size_t index, const Body& body) {
+    std::uint32_t region = body.alive ? region_of(body) : NoRegion;
+    std::uint32_t& current = body_region[index];
+    if (region == current)
+        return;
+
+    auto i = static_cast<std::uint32_t>(index);
+    if (current != NoRegion) {
+        --counts[current * NpcRegistry::size + body.type];
+        unlink(i, current);
+    }
+    if (region != NoRegion) {
+        ++counts[region * NpcRegistry::size + body.type];
+        link(i, region);
+    }
+    current = region;
+}
+
+void RegionActivity::refresh() {
+    std::size_t n = static_cast<std::size_t>(rx_count) * ry_count;
+    std::vector<std::uint8_t> present(n, 0);
+    std::vector<std::uint8_t> predators(n, 0);
+    for (std::size_t r = 0; r < n; ++r) {
+        for (std::size_t type = 0; type < NpcRegistry::size; ++type) {
+            if (!counts[r * NpcRegistry::size + type])
+                continue;
+            present[r] |= 1 << type;
+            if (NpcRegistry::predator[type])
+                predators[r] |= 1 << type;
+        }
+    }
+
+    dilate(predators, rx_count, ry_count, radius);
+
+    awake.assign(n, 0);
+    for (std::size_t r = 0; r < n; ++r)
+        for (std::size_t type = 0; type < NpcRegistry::size && !awake[r]; ++type)
+            if ((present[r] >> type & 1) && (predators[r] & eaten_by[type]))
+                awake[r] = 1;
+
+    hot = awake;
+    dilate(hot, rx_count, ry_count, radius);
+
+    awake_count = hot_count = 0;
+    for (std::size_t r = 0; r < n; ++r) {
+        std::size_t bodies = 0;
+        for (std::size_t type = 0; type < NpcRegistry::size; ++type)
+            bodies += counts[r * NpcRegistry::size + type];
+        awake_count += awake[r] ? bodies : 0;
+        hot_count += hot[r] ? bodies : 0;
+    }
+}
+
+template <class Visit>
+void RegionActivity::for_each_in(std::size_t region, Visit&& visit) const {
+    for (std::uint32_t i = head[region]; i != NoRegion; i = next[i])
+        visit(i);
+}
+
+// Walking the lists jumps around the body vector, so once a fair share of the bodies
+// is awake a plain sweep over all of them is cheaper.
+void RegionActivity::collect_moving(const std::vector<Body>& bodies, std::vector<std::uint32_t>& moving) const {
+    moving.clear();
+
+    if (awake_count * 4 > bodies.size()) {
+        for (std::size_t i = 0; i < bodies.size(); ++i)
+            if (bodies[i].alive && is_awake(i))
+                moving.push_back(static_cast<std::uint32_t>(i));
+        return;
+    }
+
+    for (std::size_t r = 0; r < awake.size(); ++r)
+        if (awake[r])
+            for_each_in(r, [&](std::uint32_t i) { moving.push_back(i); });
+}
+
+// Drift phases go by blocks of indices, so the bodies due on a tick sit together in memory.
+void RegionActivity::collect_due(const std::vector<Body>& bodies, int tick, std::vector<std::uint32_t>& due) const {
+    due.clear();
+
+    std::size_t first = (sleep.stride - tick % sleep.stride) % sleep.stride;
+    for (std::size_t block = first; block * DriftBlock < bodies.size(); block += sleep.stride) {
+        std::size_t end = std::min((block + 1) * DriftBlock, bodies.size());
+        for (std::size_t i = block * DriftBlock; i < end; ++i)
+            if (bodies[i].alive && !is_awake(i))
+                due.push_back(static_cast<std::uint32_t>(i));
+    }
+}
+
+std::size_t RegionActivity::phase_of(std::size_t body) const {
+    return body / DriftBlock;
+}
+
+void RegionActivity::collect_fighters(const std::vector<Body>& bodies, std::vector<std::uint32_t>& attackers,
+                                      std::vector<std::uint32_t>& defenders) const {
+    attackers.clear();
+    defenders.clear();
+    auto take = [&](std::uint32_t i) {
+        const Body& body = bodies[i];
+        if (NpcRegistry::prey[body.type] && awake[body_region[i]])
+            defenders.push_back(i);
+        if (NpcRegistry::predator[body.type])
+            attackers.push_back(i);
+    };
+
+    if (hot_count * 4 > bodies.size()) {
+        for (std::size_t i = 0; i < bodies.size(); ++i)
+            if (bodies[i].alive && hot[body_region[i]])
+                take(static_cast<std::uint32_t>(i));
+        return;
+    }
+
+    for (std::size_t r = 0; r < hot.size(); ++r)
+        if (hot[r])
+            for_each_in(r, take);
+}
+
+bool RegionActivity::ready() const {
+    return !awake.empty();
+}
+
+bool RegionActivity::tracks(const std::vector<Body>& bodies) const {
+    return ready() && body_region.size() == bodies.size();
+}
+
+int RegionActivity::stride() const {
+    return sleep.stride;
+}
+
+int RegionActivity::region_of(const Body& body) const {
+    int rx = std::clamp(body.x / sleep.region, 0, rx_count - 1);
+    int ry = std::clamp(body.y / sleep.region, 0, ry_count - 1);
+    return rx + ry * rx_count;
+}
+
+bool RegionActivity::is_awake(std::size_t body) const {
+    return body >= body_region.size() || body_region[body] == NoRegion || awake[body_region[body]];
+}
+
+std::size_t RegionActivity::sleeping() const {
+    return std::count(awake.begin(), awake.end(), 0);
+}
+
+std::size_t RegionActivity::regions() const {
+    return awake.size();
+}
+
+void drift_body(Body& body, const WorldConfig& config, int tick, int steps) {
+    if (steps <= 0)
+        return;
+
+    int d = NpcRegistry::speed[body.type];
+    std::uint64_t r = roll(config.seed, tick, body.id, DriftStream);
+    int shift_x, shift_y;
+
+    if (steps == 1) {
+        shift_x = roll_range(r & 0xffffffff, -d, d);
+        shift_y = roll_range(r >> 32, -d, d);
+    } else {
+        // The sum of n uniform steps on [-d, d] has variance n * d * (d + 1) / 3. Four
+        // uniforms on [-1/2, 1/2], scaled to that variance, stand in for it: a stride
+        // is only a few steps, so their sum is not yet normal. The scaling is fixed
+        // point, as this runs for every sleeping body once per stride.
+        auto scale = static_cast<std::int64_t>(std::sqrt(steps * d * (d + 1.0)) * 65536.0);
+        auto spread = [scale](std::uint64_t bits) {
+            std::int64_t sum = -2 * 65535;
+            for (int k = 0; k < 4; ++k)
+                sum += (bits >> (16 * k)) & 0xffff;
+            return static_cast<int>((sum * scale + (std::int64_t{1} << 31)) >> 32);
+        };
+
+        int limit = steps * d;
+        shift_x = std::clamp(spread(r), -limit, limit);
+        shift_y = std::clamp(spread(mix64(r)), -limit, limit);
+    }
+
+    body.x = std::clamp(body.x + shift_x, 0, config.map_x);
+    body.y = std::clamp(body.y + shift_y, 0, config.map_y);
+}
+
+void fall_asleep(Body& body, int tick) {
+    if (!body.asleep_since)
+        body.asleep_since = since_code(tick);
+}
+
+bool doze_body(Body& body, const WorldConfig& config, int tick, int stride, std::size_t phase) {
+    fall_asleep(body, tick);
+    if ((static_cast<std::uint64_t>(tick) + phase) % stride != 0)
+        return false;
+
+    // The skipped steps run up to this tick, and back to the last drift or to falling asleep.
+    int since = ticks_since(body, tick + 1);
+    drift_body(body, config, tick, std::min(since, stride));
+
+    // The code only changes on waking and falling asleep, so checkpoint deltas of a
+    // sleeping body stay plain moves; it is renewed before it could wrap around.
+    if (since > SinceWrap / 2)
+        body.asleep_since = since_code(tick + 1);
+    return true;
+}
+
+bool wake_body(Body& body, const WorldConfig& config, int tick, int stride, std::size_t phase) {
+    if (!body.asleep_since)
+        return false;
+
+    int steps = std::min(ticks_since(body, tick), ticks_since_drift(tick, stride, phase));
+    drift_body(body, config, tick, steps);
+    body.asleep_since = 0;
+    return steps > 0;
+}
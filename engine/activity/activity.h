@@ -0,0 +1,91 @@
+#pragma once
+
+#include "world.h"
+
+#include <cstdint>
+#include <vector>
+
+struct SleepConfig {
+    int region{0};
+    int stride{8};
+};
+
+// Splits the map into square regions and tracks which of them can host a fight:
+// a region is awake while it holds prey and some region close enough for one tick of
+// movement plus a kill holds a matching predator. Sleeping regions are left out of
+// the proximity pass, which is exact, and their bodies drift once every stride ticks
+// by the summed displacement of the skipped steps, which keeps the movement
+// statistically equivalent but not identical.
+//
+// Every body is linked into a list per region and follows its position through
+// relocate(), so a mostly sleeping world only pays for the awake bodies and the ones
+// due to drift. All of it is derived from the bodies, which is what lets a restored
+// world pick up where the saved one left off.
+class RegionActivity {
+private:
+    WorldConfig cfg;
+    SleepConfig sleep;
+    int rx_count;
+    int ry_count;
+    int radius;
+    std::vector<std::uint32_t> counts;
+    std::vector<std::uint32_t> body_region;
+    std::vector<std::uint32_t> head;
+    std::vector<std::uint32_t> next;
+    std::vector<std::uint32_t> prev;
+    std::vector<std::uint8_t> awake;
+    std::vector<std::uint8_t> hot;
+    std::size_t awake_count{0};
+    std::size_t hot_count{0};
+
+    void link(std::uint32_t index, std::uint32_t region);
+    void unlink(std::uint32_t index, std::uint32_t region);
+    template <class Visit>
+    void for_each_in(std::size_t region, Visit&& visit) const;
+
+public:
+    RegionActivity(const WorldConfig& config, const SleepConfig& sleep);
+
+    // Recounts every body and refreshes the regions. Needed whenever bodies were
+    // added or replaced, see tracks().
+    void rebuild(const std::vector<Body>& bodies);
+    // Moves body `index` to the region of its current position, or out of the
+    // counts once it is dead.
+    void relocate(std::size_t index, const Body& body);
+    // Recomputes the awake regions, and the hot ones within reach of them, from the counts.
+    void refresh();
+
+    // Fills `moving` with the bodies of awake regions.
+    void collect_moving(const std::vector<Body>& bodies, std::vector<std::uint32_t>& moving) const;
+    // Fills `due` with the sleeping bodies that drift on `tick`.
+    void collect_due(const std::vector<Body>& bodies, int tick, std::vector<std::uint32_t>& due) const;
+    // The phase to pass to doze_body and wake_body for a body.
+    std::size_t phase_of(std::size_t body) const;
+    // Fills the lists for the fight pass: awake prey, and predators in hot regions.
+    void collect_fighters(const std::vector<Body>& bodies, std::vector<std::uint32_t>& attackers,
+                          std::vector<std::uint32_t>& defenders) const;
+
+    bool ready() const;
+    bool tracks(const std::vector<Body>& bodies) const;
+    int stride() const;
+    int region_of(const Body& body) const;
+    // Bodies the counts have not seen yet are awake.
+    bool is_awake(std::size_t body) const;
+    std::size_t sleeping() const;
+    std::size_t regions() const;
+};
+
+// Moves a body by an approximation of `steps` random steps drawn at once.
+void drift_body(Body& body, const WorldConfig& config, int tick, int steps);
+
+// Marks a body that skips its moves from `tick` on.
+void fall_asleep(Body& body, int tick);
+
+// One tick of a body in a sleeping region: it stops moving, and on the ticks where
+// (tick + phase) % stride == 0 drifts by the steps it skipped since it fell asleep or
+// last drifted. Returns whether the body moved.
+bool doze_body(Body& body, const WorldConfig& config, int tick, int stride, std::size_t phase);
+
+// Brings a body that was sleeping up to date before its regular move of this tick.
+// Returns whether the body moved.
+bool wake_body(Body& body, const WorldConfig& config, int tick, int stride, std::size_t phase);
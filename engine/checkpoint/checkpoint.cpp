@@ -0,0 +1,279 @@
+#include "checkpoint.h"
+
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+// Keeps the simulation thread ahead of the writer on a busy core without starving it.
+constexpr int WriterNice = 5;
+
+enum RecordKind : std::uint32_t {
+    BaseRecord = 1,
+    DeltaRecord = 2
+};
+
+struct RecordHeader {
+    std::uint32_t kind;
+    std::int32_t tick;
+    std::uint64_t size;
+};
+
+struct BaseHeader {
+    std::int32_t map_x;
+    std::int32_t map_y;
+    std::uint64_t seed;
+};
+
+// Most bodies only step a few cells per tick, so plain moves are stored as 8-byte
+// offsets and everything else (spawns, deaths, long jumps) as full entries.
+struct MoveEntry {
+    std::uint32_t index;
+    std::int16_t dx;
+    std::int16_t dy;
+};
+
+struct DeltaEntry {
+    std::uint32_t index;
+    Body body;
+};
+
+bool fits(int delta) {
+    return delta >= INT16_MIN && delta <= INT16_MAX;
+}
+
+template <class T>
+void append(std::vector<char>& out, const T& value) {
+    const char* p = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <class T>
+T take(const std::vector<char>& in, std::size_t& offset) {
+    T value;
+    std::memcpy(&value, in.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+bool same(const Body& a, const Body& b) {
+    return a.id == b.id && a.x == b.x && a.y == b.y && a.type == b.type && a.alive == b.alive && a.asleep_since == b.asleep_since;
+}
+
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& path, int interval) : base_interval(std::max(1, interval)) {
+    fs.open(path, std::ios::binary | std::ios::app);
+    if (!fs)
+        throw std::runtime_error("checkpoint: cannot open " + path);
+    writer = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        closing = true;
+    }
+    cv.notify_all();
+    writer.join();
+    fs.close();
+}
+
+void CheckpointWriter::record(const World& world) {
+    std::unique_lock<std::mutex> lck(mtx);
+    cv.wait(lck, [this] { return !pending || (!pending->base && pending->replaced < MaxCoalesced); });
+    bool base = recorded++ % base_interval == 0;
+
+    if (pending) {
+        // Not taken yet and only a delta: overwrite it in place.
+        pending->base = base;
+        ++pending->replaced;
+    } else {
+        pending.emplace();
+        pending->base = base;
+        pending->bodies.swap(spare);
+    }
+    pending->config = world.config();
+    pending->tick = world.tick();
+    pending->bodies.assign(world.bodies().begin(), world.bodies().end());
+
+    lck.unlock();
+    cv.notify_all();
+}
+
+void CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lck(mtx);
+    cv.wait(lck, [this] { return !pending && !busy; });
+}
+
+void CheckpointWriter::run() {
+    // On Linux the nice value is per thread.
+    setpriority(PRIO_PROCESS, gettid(), WriterNice);
+
+    Snapshot snapshot;
+    while (true) {
+        std::unique_lock<std::mutex> lck(mtx);
+        cv.wait(lck, [this] { return closing || pending; });
+        if (!pending)
+            return;
+
+        snapshot = std::move(*pending);
+        pending.reset();
+        busy = true;
+        lck.unlock();
+        cv.notify_all();
+
+        write(snapshot);
+
+        // write() left the previous image in snapshot.bodies; reuse its buffer.
+        lck.lock();
+        busy = false;
+        spare.swap(snapshot.bodies);
+        lck.unlock();
+        cv.notify_all();
+    }
+}
+
+void CheckpointWriter::write(Snapshot& snapshot) {
+    std::vector<char> payload;
+    RecordHeader header{DeltaRecord, snapshot.tick, 0};
+
+    if (snapshot.base || previous.empty()) {
+        header.kind = BaseRecord;
+        append(payload, BaseHeader{snapshot.config.map_x, snapshot.config.map_y, snapshot.config.seed});
+        for (const auto& body : snapshot.bodies)
+            append(payload, body);
+    } else {
+        std::vector<MoveEntry> moves;
+        std::vector<DeltaEntry> changes;
+
+        for (std::size_t i = 0; i < snapshot.bodies.size(); ++i) {
+            const Body& body = snapshot.bodies[i];
+            auto index = static_cast<std::uint32_t>(i);
+
+            if (i >= previous.size()) {
+                changes.push_back({index, body});
+                continue;
+            }
+
+            const Body& before = previous[i];
+            if (same(before, body))
+                continue;
+
+            int dx = body.x - before.x;
+            int dy = body.y - before.y;
+            bool moved_only = body.id == before.id && body.type == before.type && body.alive == before.alive &&
+                              body.asleep_since == before.asleep_since;
+
+            if (moved_only && fits(dx) && fits(dy))
+                moves.push_back({index, static_cast<std::int16_t>(dx), static_cast<std::int16_t>(dy)});
+            else
+                changes.push_back({index, body});
+        }
+
+        append(payload, static_cast<std::uint32_t>(moves.size()));
+        for (const auto& move : moves)
+            append(payload, move);
+        for (const auto& change : changes)
+            append(payload, change);
+    }
+
+    header.size = payload.size();
+    fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fs.write(payload.data(), payload.size());
+    fs.flush();
+
+    previous.swap(snapshot.bodies);
+}
+
+World load_checkpoint(const std::string& path) {
+    std::ifstream is(path, std::ios::binary | std::ios::ate);
+    if (!is)
+        throw std::runtime_error("checkpoint: cannot open " + path);
+    std::streamoff file_size = is.tellg();
+
+    // Walk the headers only, to find the last complete base image.
+    RecordHeader header;
+    std::streamoff offset = 0;
+    std::streamoff last_base = -1;
+    is.seekg(0);
+    while (offset + static_cast<std::streamoff>(sizeof(header)) <= file_size) {
+        is.seekg(offset);
+        if (!is.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            break;
+        std::streamoff end = offset + static_cast<std::streamoff>(sizeof(header) + header.size);
+        if (header.size > static_cast<std::uint64_t>(file_size) || end > file_size)
+            break;
+        if (header.kind == BaseRecord)
+            last_base = offset;
+        offset = end;
+    }
+    std::streamoff valid_end = offset;
+
+    if (last_base < 0)
+        throw std::runtime_error("checkpoint: no base image in " + path);
+
+    WorldConfig config;
+    int tick = 0;
+    std::vector<Body> bodies;
+    std::vector<char> payload;
+    auto corrupt = [&path]() {
+        return std::runtime_error("checkpoint: corrupt record in " + path);
+    };
+
+    is.clear();
+    is.seekg(last_base);
+    for (offset = last_base; offset < valid_end; offset += sizeof(header) + header.size) {
+        is.read(reinterpret_cast<char*>(&header), sizeof(header));
+        payload.resize(header.size);
+        is.read(payload.data(), header.size);
+
+        std::size_t at = 0;
+        if (header.kind == BaseRecord) {
+            if (payload.size() < sizeof(BaseHeader))
+                throw corrupt();
+            BaseHeader base = take<BaseHeader>(payload, at);
+            config.map_x = base.map_x;
+            config.map_y = base.map_y;
+            config.seed = base.seed;
+            bodies.resize((payload.size() - at) / sizeof(Body));
+            if (!bodies.empty())
+                std::memcpy(bodies.data(), payload.data() + at, bodies.size() * sizeof(Body));
+        } else if (header.kind == DeltaRecord) {
+            if (payload.size() < sizeof(std::uint32_t))
+                throw corrupt();
+            auto moves = take<std::uint32_t>(payload, at);
+            if (moves > (payload.size() - at) / sizeof(MoveEntry))
+                throw corrupt();
+            for (std::uint32_t i = 0; i < moves; ++i) {
+                MoveEntry move = take<MoveEntry>(payload, at);
+                if (move.index >= bodies.size())
+                    throw corrupt();
+                bodies[move.index].x += move.dx;
+                bodies[move.index].y += move.dy;
+            }
+            while (at + sizeof(DeltaEntry) <= payload.size()) {
+                DeltaEntry entry = take<DeltaEntry>(payload, at);
+                // New bodies are appended in order, so an entry may grow the vector by one at most.
+                if (entry.index > bodies.size())
+                    throw corrupt();
+                if (entry.index == bodies.size())
+                    bodies.push_back(entry.body);
+                else
+                    bodies[entry.index] = entry.body;
+            }
+        } else {
+            continue;
+        }
+        tick = header.tick;
+    }
+
+    World world(config);
+    world.restore(tick, std::move(bodies));
+    return world;
+}
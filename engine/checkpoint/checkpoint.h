@@ -0,0 +1,68 @@
+#pragma once
+
+#include "world.h"
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+// Append-only checkpoint log: a full base image every base_interval records and,
+// in between, deltas holding only the bodies that moved, died or spawned since the
+// previous record. The RNG is counter-based, so seed and tick are its whole state
+// and a restored world continues exactly as the original would have.
+class CheckpointWriter {
+public:
+    static constexpr int MaxCoalesced = 4;
+
+private:
+    struct Snapshot {
+        WorldConfig config;
+        int tick{0};
+        bool base{false};
+        // Records this one has absorbed while waiting for the writer.
+        int replaced{0};
+        std::vector<Body> bodies;
+    };
+
+    std::ofstream fs;
+    int base_interval;
+    int recorded{0};
+    std::vector<Body> previous;
+
+    // Double buffer: the simulation thread fills `pending` while the writer works on
+    // its own snapshot, and the writer hands its buffer back through `spare`.
+    std::optional<Snapshot> pending;
+    std::vector<Body> spare;
+    bool busy{false};
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool closing{false};
+    std::thread writer;
+
+    // Swaps the written image into `previous`, leaving the older one in `snapshot`.
+    void write(Snapshot& snapshot);
+    void run();
+
+public:
+    CheckpointWriter(const std::string& path, int base_interval = 100);
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // Copies the world state for the background writer. If the writer is still busy,
+    // the newest record replaces the one not yet taken, so a slow disk costs skipped
+    // deltas. The lag is bounded: a pending base image is never replaced, and a delta
+    // absorbs at most MaxCoalesced records, after which record() waits for the writer.
+    void record(const World& world);
+    // Blocks until everything recorded so far is on disk.
+    void flush();
+};
+
+// Seeks to the latest base image and replays the deltas after it. A record cut off
+// by a crash is ignored. Throws std::runtime_error if the file holds no base image
+// or a record points outside the bodies it describes.
+World load_checkpoint(const std::string& path);
@@ -0,0 +1,83 @@
+#include "ensemble.h"
+
+#include <thread>
+#include <atomic>
+
+void EnsembleResult::merge(const EnsembleResult& other) {
+    runs += other.runs;
+    for (std::size_t type = 0; type < survivors.size(); ++type) {
+        spawned[type] += other.spawned[type];
+        survived[type] += other.survived[type];
+
+        auto& mine = survivors[type];
+        const auto& theirs = other.survivors[type];
+        if (mine.size() < theirs.size())
+            mine.resize(theirs.size(), 0);
+        for (std::size_t k = 0; k < theirs.size(); ++k)
+            mine[k] += theirs[k];
+    }
+}
+
+double EnsembleResult::survival_rate(NpcType type) const {
+    return spawned[type] ? static_cast<double>(survived[type]) / spawned[type] : 0.0;
+}
+
+double EnsembleResult::extinction_rate(NpcType type) const {
+    if (runs == 0 || survivors[type].empty())
+        return 0.0;
+    return static_cast<double>(survivors[type][0]) / runs;
+}
+
+std::uint64_t ensemble_seed(std::uint64_t base_seed, int run) {
+    return mix64(base_seed + static_cast<std::uint64_t>(run));
+}
+
+EnsembleResult run_ensemble(const EnsembleConfig& config) {
+    check_mix(config.mix);
+
+    unsigned threads = config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, std::max(config.runs, 1));
+
+    std::vector<EnsembleResult> partial(threads);
+    std::atomic<int> next{0};
+
+    auto worker = [&](EnsembleResult& result) {
+        for (int run = next++; run < config.runs; run = next++) {
+            WorldConfig world_config = config.world;
+            world_config.seed = ensemble_seed(config.world.seed, run);
+
+            World world(world_config);
+            for (const auto& body : random_population(world_config, config.npcs, config.mix))
+                world.add(body);
+
+            auto spawned = world.alive_by_type();
+            while (world.tick() < config.ticks && !world.settled())
+                world.step();
+            auto alive = world.alive_by_type();
+
+            ++result.runs;
+            for (std::size_t type = 0; type < alive.size(); ++type) {
+                if (config.mix[type] == 0)
+                    continue;
+                result.spawned[type] += spawned[type];
+                result.survived[type] += alive[type];
+
+                auto& histogram = result.survivors[type];
+                if (histogram.size() <= static_cast<std::size_t>(alive[type]))
+                    histogram.resize(alive[type] + 1, 0);
+                ++histogram[alive[type]];
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; ++i)
+        pool.emplace_back(worker, std::ref(partial[i]));
+    for (auto& t : pool)
+        t.join();
+
+    EnsembleResult total;
+    for (const auto& p : partial)
+        total.merge(p);
+    return total;
+}
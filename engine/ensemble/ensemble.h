@@ -0,0 +1,35 @@
+#pragma once
+
+#include "world.h"
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+struct EnsembleConfig {
+    WorldConfig world;
+    PopulationMix mix{EvenMix};
+    int runs{1000};
+    int npcs{50};
+    int ticks{300};
+    unsigned threads{0};
+};
+
+struct EnsembleResult {
+    int runs{0};
+    NpcRegistry::Table<std::uint64_t> spawned{};
+    NpcRegistry::Table<std::uint64_t> survived{};
+    // survivors[type][k] is the number of runs that ended with exactly k survivors of that type.
+    NpcRegistry::Table<std::vector<std::uint64_t>> survivors;
+
+    void merge(const EnsembleResult& other);
+    double survival_rate(NpcType type) const;
+    double extinction_rate(NpcType type) const;
+};
+
+// Seed of the run-th world in an ensemble; lets a single run be replayed on its own.
+std::uint64_t ensemble_seed(std::uint64_t base_seed, int run);
+
+// Runs independent seeded worlds on all cores. A world stops early once no
+// predator and prey of a compatible pair are alive, because nothing can change after that.
+EnsembleResult run_ensemble(const EnsembleConfig& config);
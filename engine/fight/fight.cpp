@@ -0,0 +1,214 @@
+#include "fight.h"
+#include "registry.h"
+
+#include <limits>
+
+namespace {
+
+constexpr std::uint32_t NoClaim = std::numeric_limits<std::uint32_t>::max();
+
+int dice(std::uint64_t r) {
+    return static_cast<int>(r % 6) + 1;
+}
+
+}
+
+bool is_prey(NpcType type) {
+    return NpcRegistry::prey[type];
+}
+
+bool is_predator(NpcType type) {
+    return NpcRegistry::predator[type];
+}
+
+int max_kill_distance() {
+    return NpcRegistry::max_reach;
+}
+
+bool attack_wins(const WorldConfig& config, int tick, const Body& attacker, const Body& defender) {
+    std::uint64_t r = roll(config.seed ^ FightStream, tick, attacker.id, defender.id);
+    return dice(r >> 32) > dice(r & 0xffffffff);
+}
+
+namespace {
+
+// Buckets the attackers into a grid of kill-range cells over their bounding box and
+// checks each defender against the nine cells around it. Both arguments call their
+// visitor with every candidate index; alive and type filtering is up to them.
+template <class Attackers, class Defenders>
+FightBatch collect(const std::vector<Body>& bodies, const Attackers& for_each_attacker, const Defenders& for_each_defender) {
+    int cell = std::max(1, max_kill_distance());
+
+    int min_x = std::numeric_limits<int>::max(), min_y = min_x;
+    int max_x = std::numeric_limits<int>::min(), max_y = max_x;
+    for_each_attacker([&](std::uint32_t a) {
+        min_x = std::min(min_x, bodies[a].x / cell);
+        min_y = std::min(min_y, bodies[a].y / cell);
+        max_x = std::max(max_x, bodies[a].x / cell);
+        max_y = std::max(max_y, bodies[a].y / cell);
+    });
+
+    FightBatch batch;
+    if (min_x > max_x) {
+        batch.group_start.fill(0);
+        return batch;
+    }
+
+    int grid_x = max_x - min_x + 1;
+    int grid_y = max_y - min_y + 1;
+
+    std::vector<std::uint32_t> start(grid_x * grid_y + 1, 0);
+
+    auto cell_of = [&](const Body& b) {
+        return (b.x / cell - min_x) + (b.y / cell - min_y) * grid_x;
+    };
+
+    constexpr auto& reach = NpcRegistry::reach;
+    constexpr auto& eats = NpcRegistry::eats;
+
+    for_each_attacker([&](std::uint32_t a) { ++start[cell_of(bodies[a]) + 1]; });
+    for (std::size_t c = 1; c < start.size(); ++c)
+        start[c] += start[c - 1];
+
+    std::vector<std::uint32_t> order(start.back());
+    std::vector<std::uint32_t> fill(start.begin(), start.end() - 1);
+    for_each_attacker([&](std::uint32_t a) { order[fill[cell_of(bodies[a])]++] = a; });
+
+    std::array<std::vector<FightPair>, FightGroups> groups;
+
+    for_each_defender([&](std::uint32_t d) {
+        const Body& defender = bodies[d];
+
+        int cx = defender.x / cell - min_x;
+        int cy = defender.y / cell - min_y;
+
+        for (int gy = std::max(cy - 1, 0); gy <= std::min(cy + 1, grid_y - 1); ++gy) {
+            for (int gx = std::max(cx - 1, 0); gx <= std::min(cx + 1, grid_x - 1); ++gx) {
+                int c = gx + gy * grid_x;
+                for (std::uint32_t k = start[c]; k < start[c + 1]; ++k) {
+                    std::uint32_t a = order[k];
+                    const Body& attacker = bodies[a];
+
+                    if (a == d || !eats[attacker.type][defender.type])
+                        continue;
+
+                    int dx = attacker.x - defender.x;
+                    int dy = attacker.y - defender.y;
+                    int r = reach[attacker.type];
+                    if (dx * dx + dy * dy > r * r)
+                        continue;
+
+                    groups[fight_group(attacker.type, defender.type)].push_back({a, d});
+                }
+            }
+        }
+    });
+
+    for (std::size_t g = 0; g < groups.size(); ++g) {
+        batch.group_start[g] = batch.pairs.size();
+        batch.pairs.insert(batch.pairs.end(), groups[g].begin(), groups[g].end());
+    }
+    batch.group_start[groups.size()] = batch.pairs.size();
+
+    return batch;
+}
+
+std::vector<Kill> kills_of(const WorldConfig& config, int tick, const std::vector<Body>& bodies, const FightBatch& batch) {
+    auto outcomes = resolve_fights(config, tick, bodies, batch);
+
+    std::vector<Kill> kills;
+    for (std::size_t i = 0; i < outcomes.size(); ++i)
+        if (outcomes[i] == FightKilled)
+            kills.push_back({batch.pairs[i].attacker, batch.pairs[i].defender});
+
+    std::sort(kills.begin(), kills.end(), [](const Kill& a, const Kill& b) { return a.defender < b.defender; });
+    return kills;
+}
+
+}
+
+FightBatch collect_fights(const WorldConfig&, const std::vector<Body>& bodies, std::size_t defenders) {
+    // Only types that eat someone can be attackers, so only they go into the grid.
+    auto attackers = [&](auto visit) {
+        for (std::size_t i = 0; i < bodies.size(); ++i)
+            if (bodies[i].alive && is_predator(bodies[i].type))
+                visit(static_cast<std::uint32_t>(i));
+    };
+    auto targets = [&](auto visit) {
+        for (std::size_t i = 0; i < defenders; ++i)
+            if (bodies[i].alive && is_prey(bodies[i].type))
+                visit(static_cast<std::uint32_t>(i));
+    };
+    return collect(bodies, attackers, targets);
+}
+
+FightBatch collect_fights(const WorldConfig&, const std::vector<Body>& bodies, const std::vector<std::uint32_t>& attackers,
+                          const std::vector<std::uint32_t>& defenders) {
+    auto each = [](const std::vector<std::uint32_t>& indices) {
+        return [&indices](auto visit) {
+            for (std::uint32_t i : indices)
+                visit(i);
+        };
+    };
+    return collect(bodies, each(attackers), each(defenders));
+}
+
+std::vector<std::uint8_t> resolve_fights(const WorldConfig& config, int tick, const std::vector<Body>& bodies, const FightBatch& batch) {
+    const auto& pairs = batch.pairs;
+    std::size_t n = pairs.size();
+    if (n == 0)
+        return {};
+
+    std::vector<std::uint32_t> attacker_id(n);
+    std::vector<std::uint32_t> defender_id(n);
+    std::vector<std::uint64_t> rolls(n);
+    std::vector<std::uint8_t> outcomes(n);
+    std::vector<std::uint32_t> claim(bodies.size(), NoClaim);
+    std::uint64_t seed = config.seed ^ FightStream;
+
+    // Each type pair is a contiguous run of straight-line loops over plain arrays, so
+    // the compiler can vectorize the hashing and compares on targets with 64-bit
+    // vector multiplies. Only the claim array is shared, as one defender type may
+    // have several predator types.
+    for (std::size_t g = 0; g + 1 < batch.group_start.size(); ++g) {
+        std::size_t begin = batch.group_start[g];
+        std::size_t end = batch.group_start[g + 1];
+        if (begin == end)
+            continue;
+
+        for (std::size_t i = begin; i < end; ++i) {
+            attacker_id[i] = bodies[pairs[i].attacker].id;
+            defender_id[i] = bodies[pairs[i].defender].id;
+        }
+        for (std::size_t i = begin; i < end; ++i)
+            rolls[i] = roll(seed, tick, attacker_id[i], defender_id[i]);
+        for (std::size_t i = begin; i < end; ++i)
+            outcomes[i] = dice(rolls[i] >> 32) > dice(rolls[i] & 0xffffffff) ? FightWon : FightLost;
+        for (std::size_t i = begin; i < end; ++i)
+            if (outcomes[i] == FightWon)
+                claim[pairs[i].defender] = std::min(claim[pairs[i].defender], attacker_id[i]);
+    }
+
+    for (std::size_t i = 0; i < n; ++i)
+        if (outcomes[i] == FightWon && claim[pairs[i].defender] == attacker_id[i])
+            outcomes[i] = FightKilled;
+
+    return outcomes;
+}
+
+std::vector<std::uint8_t> resolve_fights(const WorldConfig& config, int tick, const std::vector<Body>& bodies, const std::vector<FightPair>& pairs) {
+    FightBatch batch;
+    batch.pairs = pairs;
+    batch.group_start.fill(pairs.size());
+    batch.group_start[0] = 0;
+    return resolve_fights(config, tick, bodies, batch);
+}
+
+std::vector<Kill> find_kills(const WorldConfig& config, int tick, const std::vector<Body>& bodies, std::size_t defenders) {
+    return kills_of(config, tick, bodies, collect_fights(config, bodies, defenders));
+}
+
+std::vector<Kill> find_kills(const WorldConfig& config, int tick, const std::vector<Body>& bodies,
+                             const std::vector<std::uint32_t>& attackers, const std::vector<std::uint32_t>& defenders) {
+    return kills_of(config, tick, bodies, collect_fights(config, bodies, attackers, defenders));
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "world.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Tick fight rules shared by World and the shard workers. Every fight in a tick
+// sees the alive flags from the start of the fight phase, and a defender beaten by
+// several attackers is claimed by the one with the smallest id, so the outcome does
+// not depend on iteration order or on how the map is split between processes.
+
+struct Kill {
+    std::size_t attacker;
+    std::size_t defender;
+};
+
+// Indices into the body vector the batch was collected from.
+struct FightPair {
+    std::uint32_t attacker;
+    std::uint32_t defender;
+};
+
+enum FightOutcome : std::uint8_t {
+    FightLost = 0,
+    FightWon = 1,
+    FightKilled = 2
+};
+
+// Candidate duels grouped by (attacker type, defender type); group g = fight_group(attacker, defender)
+// occupies pairs[group_start[g], group_start[g + 1]).
+constexpr std::size_t FightGroups = NpcRegistry::size * NpcRegistry::size;
+
+constexpr std::size_t fight_group(NpcType attacker, NpcType defender) {
+    return attacker * NpcRegistry::size + defender;
+}
+
+struct FightBatch {
+    std::vector<FightPair> pairs;
+    std::array<std::size_t, FightGroups + 1> group_start{};
+};
+
+bool is_prey(NpcType type);
+bool is_predator(NpcType type);
+int max_kill_distance();
+bool attack_wins(const WorldConfig& config, int tick, const Body& attacker, const Body& defender);
+
+// Bodies [0, defenders) are checked as defenders, the whole vector is used as attackers.
+FightBatch collect_fights(const WorldConfig& config, const std::vector<Body>& bodies, std::size_t defenders);
+// Only the listed bodies take part; they must be alive, attackers predators and defenders prey.
+FightBatch collect_fights(const WorldConfig& config, const std::vector<Body>& bodies, const std::vector<std::uint32_t>& attackers,
+                          const std::vector<std::uint32_t>& defenders);
+
+// Rolls the duels of the batch one type-pair group at a time, then lets the first winner
+// (smallest attacker id) claim each defender across all groups. The result holds one FightOutcome per pair.
+std::vector<std::uint8_t> resolve_fights(const WorldConfig& config, int tick, const std::vector<Body>& bodies, const FightBatch& batch);
+// Same for an ungrouped list, resolved as a single group.
+std::vector<std::uint8_t> resolve_fights(const WorldConfig& config, int tick, const std::vector<Body>& bodies, const std::vector<FightPair>& pairs);
+
+std::vector<Kill> find_kills(const WorldConfig& config, int tick, const std::vector<Body>& bodies, std::size_t defenders);
+std::vector<Kill> find_kills(const WorldConfig& config, int tick, const std::vector<Body>& bodies,
+                             const std::vector<std::uint32_t>& attackers, const std::vector<std::uint32_t>& defenders);
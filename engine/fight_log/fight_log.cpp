@@ -0,0 +1,293 @@
+#include "fight_log.h"
+#include "fight.h"
+#include "registry.h"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::uint32_t FightLogMagic = 0x46375748;
+
+struct FightLogFooter {
+    std::uint64_t index_offset;
+    std::uint64_t blocks;
+    std::uint32_t magic;
+    std::uint32_t reserved;
+};
+
+void put_varint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+void put_signed(std::vector<std::uint8_t>& out, std::int64_t value) {
+    put_varint(out, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+}
+
+std::runtime_error corrupt_block() {
+    return std::runtime_error("fight log: corrupt block");
+}
+
+std::uint8_t get_byte(const std::vector<std::uint8_t>& in, std::size_t& offset) {
+    if (offset >= in.size())
+        throw corrupt_block();
+    return in[offset++];
+}
+
+std::uint64_t get_varint(const std::vector<std::uint8_t>& in, std::size_t& offset) {
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        std::uint8_t byte = get_byte(in, offset);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    throw corrupt_block();
+}
+
+NpcType get_type(const std::vector<std::uint8_t>& in, std::size_t& offset) {
+    std::uint8_t type = get_byte(in, offset);
+    if (type >= NpcRegistry::size)
+        throw corrupt_block();
+    return static_cast<NpcType>(type);
+}
+
+std::int64_t get_signed(const std::vector<std::uint8_t>& in, std::size_t& offset) {
+    std::uint64_t value = get_varint(in, offset);
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+}
+
+FightLogWriter::FightLogWriter(const std::string& path, std::size_t size) : block_size(std::max<std::size_t>(1, size)) {
+    fs.open(path, std::ios::binary | std::ios::trunc);
+    if (!fs)
+        throw std::runtime_error("fight log: cannot open " + path);
+    pending.reserve(block_size);
+}
+
+FightLogWriter::~FightLogWriter() {
+    close();
+}
+
+void FightLogWriter::add(const FightRecord& record) {
+    pending.push_back(record);
+    if (pending.size() == block_size)
+        write_block();
+}
+
+void FightLogWriter::on_kill(int tick, const Body& attacker, const Body& defender) {
+    FightRecord record;
+    record.tick = tick;
+    record.attacker_id = attacker.id;
+    record.attacker_type = attacker.type;
+    record.attacker_x = attacker.x;
+    record.attacker_y = attacker.y;
+    record.defender_id = defender.id;
+    record.defender_type = defender.type;
+    record.defender_x = defender.x;
+    record.defender_y = defender.y;
+    record.outcome = FightKilled;
+    add(record);
+}
+
+void FightLogWriter::write_block() {
+    if (pending.empty())
+        return;
+
+    FightBlockIndex block{};
+    block.offset = offset;
+    block.count = static_cast<std::uint32_t>(pending.size());
+    block.min_tick = block.max_tick = pending[0].tick;
+    block.min_attacker = block.max_attacker = pending[0].attacker_id;
+    block.min_defender = block.max_defender = pending[0].defender_id;
+    block.min_x = block.max_x = pending[0].defender_x;
+    block.min_y = block.max_y = pending[0].defender_y;
+
+    for (const auto& r : pending) {
+        block.min_tick = std::min(block.min_tick, r.tick);
+        block.max_tick = std::max(block.max_tick, r.tick);
+        block.min_attacker = std::min(block.min_attacker, r.attacker_id);
+        block.max_attacker = std::max(block.max_attacker, r.attacker_id);
+        block.min_defender = std::min(block.min_defender, r.defender_id);
+        block.max_defender = std::max(block.max_defender, r.defender_id);
+        block.min_x = std::min(block.min_x, r.defender_x);
+        block.max_x = std::max(block.max_x, r.defender_x);
+        block.min_y = std::min(block.min_y, r.defender_y);
+        block.max_y = std::max(block.max_y, r.defender_y);
+    }
+
+    std::vector<std::uint8_t> out;
+    std::int64_t previous = block.min_tick;
+    put_signed(out, previous);
+    for (const auto& r : pending) {
+        put_signed(out, r.tick - previous);
+        previous = r.tick;
+    }
+    for (const auto& r : pending) put_varint(out, r.attacker_id);
+    for (const auto& r : pending) out.push_back(static_cast<std::uint8_t>(r.attacker_type));
+    for (const auto& r : pending) put_signed(out, r.attacker_x);
+    for (const auto& r : pending) put_signed(out, r.attacker_y);
+    for (const auto& r : pending) put_varint(out, r.defender_id);
+    for (const auto& r : pending) out.push_back(static_cast<std::uint8_t>(r.defender_type));
+    for (const auto& r : pending) put_signed(out, r.defender_x - r.attacker_x);
+    for (const auto& r : pending) put_signed(out, r.defender_y - r.attacker_y);
+    for (const auto& r : pending) out.push_back(r.outcome);
+
+    block.bytes = static_cast<std::uint32_t>(out.size());
+    fs.write(reinterpret_cast<const char*>(out.data()), out.size());
+    offset += out.size();
+
+    index.push_back(block);
+    pending.clear();
+}
+
+void FightLogWriter::close() {
+    if (!fs.is_open())
+        return;
+
+    write_block();
+
+    FightLogFooter footer{offset, index.size(), FightLogMagic, 0};
+    fs.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(FightBlockIndex));
+    fs.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    fs.close();
+}
+
+bool FightQuery::may_match(const FightBlockIndex& block) const {
+    if (block.max_tick < tick_from || block.min_tick > tick_to)
+        return false;
+    if (attacker && (*attacker < block.min_attacker || *attacker > block.max_attacker))
+        return false;
+    if (box) {
+        auto [x0, y0, x1, y1] = *box;
+        if (block.max_x < x0 || block.min_x > x1 || block.max_y < y0 || block.min_y > y1)
+            return false;
+    }
+    return true;
+}
+
+bool FightQuery::matches(const FightRecord& r) const {
+    if (r.tick < tick_from || r.tick > tick_to)
+        return false;
+    if (attacker && r.attacker_id != *attacker)
+        return false;
+    if (attacker_type && r.attacker_type != *attacker_type)
+        return false;
+    if (box) {
+        auto [x0, y0, x1, y1] = *box;
+        if (r.defender_x < x0 || r.defender_x > x1 || r.defender_y < y0 || r.defender_y > y1)
+            return false;
+    }
+    return true;
+}
+
+bool parse_body_name(const std::string& name, FightQuery& query) {
+    auto sep = name.rfind('_');
+    if (sep == std::string::npos || sep + 1 == name.size())
+        return false;
+
+    std::string prefix = name.substr(0, sep);
+    NpcType found = Unknown;
+    for (NpcType type : NpcRegistry::types)
+        if (NpcRegistry::name[type] == prefix)
+            found = type;
+    if (found == Unknown)
+        return false;
+
+    std::uint32_t id = 0;
+    const char* first = name.data() + sep + 1;
+    const char* last = name.data() + name.size();
+    auto [end, error] = std::from_chars(first, last, id);
+    if (error != std::errc() || end != last)
+        return false;
+
+    query.attacker_type = found;
+    query.attacker = id;
+    return true;
+}
+
+FightLogReader::FightLogReader(const std::string& path) : is(path, std::ios::binary | std::ios::ate) {
+    if (!is)
+        throw std::runtime_error("fight log: cannot open " + path);
+    auto file_size = static_cast<std::uint64_t>(is.tellg());
+
+    FightLogFooter footer{};
+    if (file_size < sizeof(footer))
+        throw std::runtime_error("fight log: no index in " + path);
+    is.seekg(-static_cast<std::streamoff>(sizeof(footer)), std::ios::end);
+    if (!is.read(reinterpret_cast<char*>(&footer), sizeof(footer)) || footer.magic != FightLogMagic)
+        throw std::runtime_error("fight log: no index in " + path);
+
+    // The index sits between the last block and the footer, so it must end exactly there.
+    std::uint64_t index_space = file_size - sizeof(footer);
+    auto corrupt = [&path]() {
+        return std::runtime_error("fight log: corrupt index in " + path);
+    };
+    if (footer.index_offset > index_space || footer.blocks > (index_space - footer.index_offset) / sizeof(FightBlockIndex) ||
+        footer.index_offset + footer.blocks * sizeof(FightBlockIndex) != index_space)
+        throw corrupt();
+
+    index.resize(footer.blocks);
+    is.seekg(static_cast<std::streamoff>(footer.index_offset));
+    if (!is.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(FightBlockIndex)))
+        throw corrupt();
+
+    // Every record takes at least one byte per column.
+    for (const auto& block : index)
+        if (block.offset > footer.index_offset || block.bytes > footer.index_offset - block.offset || block.count > block.bytes)
+            throw corrupt();
+}
+
+const std::vector<FightBlockIndex>& FightLogReader::blocks() const {
+    return index;
+}
+
+std::vector<FightRecord> FightLogReader::read_block(std::size_t b) {
+    const FightBlockIndex& block = index.at(b);
+
+    std::vector<std::uint8_t> in(block.bytes);
+    is.clear();
+    is.seekg(static_cast<std::streamoff>(block.offset));
+    if (!is.read(reinterpret_cast<char*>(in.data()), in.size()))
+        throw corrupt_block();
+
+    std::vector<FightRecord> records(block.count);
+    std::size_t offset = 0;
+
+    std::int64_t tick = get_signed(in, offset);
+    for (auto& r : records) {
+        tick += get_signed(in, offset);
+        r.tick = static_cast<std::int32_t>(tick);
+    }
+    for (auto& r : records) r.attacker_id = static_cast<std::uint32_t>(get_varint(in, offset));
+    for (auto& r : records) r.attacker_type = get_type(in, offset);
+    for (auto& r : records) r.attacker_x = static_cast<std::int32_t>(get_signed(in, offset));
+    for (auto& r : records) r.attacker_y = static_cast<std::int32_t>(get_signed(in, offset));
+    for (auto& r : records) r.defender_id = static_cast<std::uint32_t>(get_varint(in, offset));
+    for (auto& r : records) r.defender_type = get_type(in, offset);
+    for (auto& r : records) r.defender_x = r.attacker_x + static_cast<std::int32_t>(get_signed(in, offset));
+    for (auto& r : records) r.defender_y = r.attacker_y + static_cast<std::int32_t>(get_signed(in, offset));
+    for (auto& r : records) r.outcome = get_byte(in, offset);
+    if (offset != in.size())
+        throw corrupt_block();
+
+    return records;
+}
+
+std::size_t FightLogReader::query(const FightQuery& q, const std::function<void(const FightRecord&)>& visit) {
+    std::size_t read = 0;
+    for (std::size_t b = 0; b < index.size(); ++b) {
+        if (!q.may_match(index[b]))
+            continue;
+        ++read;
+        for (const auto& record : read_block(b))
+            if (q.matches(record))
+                visit(record);
+    }
+    return read;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "world.h"
+
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct FightRecord {
+    std::int32_t tick{0};
+    std::uint32_t attacker_id{0};
+    NpcType attacker_type{Unknown};
+    std::int32_t attacker_x{0};
+    std::int32_t attacker_y{0};
+    std::uint32_t defender_id{0};
+    NpcType defender_type{Unknown};
+    std::int32_t defender_x{0};
+    std::int32_t defender_y{0};
+    std::uint8_t outcome{0};
+};
+
+// Summary of one block, kept in the index at the end of the file so that a query
+// only reads the blocks whose ranges can contain a match. The box is over defender
+// positions, that is over the places where fights happened.
+struct FightBlockIndex {
+    std::uint64_t offset;
+    std::uint32_t bytes;
+    std::uint32_t count;
+    std::int32_t min_tick, max_tick;
+    std::uint32_t min_attacker, max_attacker;
+    std::uint32_t min_defender, max_defender;
+    std::int32_t min_x, min_y, max_x, max_y;
+};
+
+// Writes fight records column by column in blocks; ticks are delta coded and every
+// column is a zigzag varint stream, which keeps a typical record to a dozen bytes.
+class FightLogWriter : public IKillObserver {
+private:
+    std::ofstream fs;
+    std::size_t block_size;
+    std::vector<FightRecord> pending;
+    std::vector<FightBlockIndex> index;
+    std::uint64_t offset{0};
+
+    void write_block();
+
+public:
+    explicit FightLogWriter(const std::string& path, std::size_t block_size = 65536);
+    ~FightLogWriter();
+
+    FightLogWriter(const FightLogWriter&) = delete;
+    FightLogWriter& operator=(const FightLogWriter&) = delete;
+
+    void add(const FightRecord& record);
+    void on_kill(int tick, const Body& attacker, const Body& defender) override;
+
+    // Writes the last partial block and the index; called by the destructor.
+    void close();
+};
+
+struct FightQuery {
+    std::optional<std::uint32_t> attacker;
+    std::optional<NpcType> attacker_type;
+    std::int32_t tick_from{INT_MIN};
+    std::int32_t tick_to{INT_MAX};
+    std::optional<std::array<std::int32_t, 4>> box;
+
+    bool may_match(const FightBlockIndex& block) const;
+    bool matches(const FightRecord& record) const;
+};
+
+// Parses "Knight_17" into an attacker filter; false unless the prefix is a known type
+// name and the suffix a plain number.
+bool parse_body_name(const std::string& name, FightQuery& query);
+
+// Throws std::runtime_error when the index does not fit the file or a block does
+// not decode to exactly its records.
+class FightLogReader {
+private:
+    std::ifstream is;
+    std::vector<FightBlockIndex> index;
+
+public:
+    explicit FightLogReader(const std::string& path);
+
+    const std::vector<FightBlockIndex>& blocks() const;
+    std::vector<FightRecord> read_block(std::size_t block);
+
+    // Calls visit for every matching record and returns the number of blocks read.
+    std::size_t query(const FightQuery& query, const std::function<void(const FightRecord&)>& visit);
+};
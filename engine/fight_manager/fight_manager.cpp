@@ -0,0 +1,145 @@
+#include "fight_manager.h"
+
+#include <utility>
+
+FightManager& FightManager::get() {
+    static FightManager instance;
+    return instance;
+}
+
+void FightManager::add_event(FightEvent&& event) {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        events.push(std::move(event));
+    }
+    ready.notify_one();
+}
+
+std::size_t FightManager::drain() {
+    std::queue<FightEvent> taken;
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        taken.swap(events);
+    }
+
+    std::size_t count = taken.size();
+    resolve(taken, {});
+    return count;
+}
+
+std::size_t FightManager::pending() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return events.size();
+}
+
+bool FightManager::past_deadline() const {
+    return discarding || std::chrono::steady_clock::now().time_since_epoch().count() > deadline;
+}
+
+void FightManager::resolve(std::queue<FightEvent>& taken, std::stop_token stop) {
+    while (!taken.empty()) {
+        if (stop.stop_requested() && past_deadline())
+            break;
+
+        FightEvent& event = taken.front();
+        if (event.attacker->is_alive() && event.defender->is_alive())
+            if (event.defender->accept(event.attacker))
+                event.defender->must_die();
+        taken.pop();
+        ++resolved;
+    }
+}
+
+void FightManager::run(std::stop_token stop) {
+    std::unique_lock<std::mutex> lck(mtx);
+    while (true) {
+        ready.wait(lck, stop, [this] { return !events.empty(); });
+        if (events.empty() || (stop.stop_requested() && past_deadline()))
+            break;
+
+        std::queue<FightEvent> taken;
+        taken.swap(events);
+        lck.unlock();
+        resolve(taken, stop);
+        lck.lock();
+
+        if (!taken.empty()) {
+            dropped += taken.size();
+            doomed.push_back(std::move(taken));
+        }
+    }
+
+    // Dropped events are only counted here; releasing them can take long for a big
+    // queue, so stop() does it after the deadline is checked.
+    dropped += events.size();
+    doomed.push_back(std::exchange(events, {}));
+}
+
+void FightManager::start() {
+    discarding = false;
+    worker = std::jthread([this](std::stop_token stop) { run(stop); });
+}
+
+ShutdownReport FightManager::stop(ShutdownMode mode, std::chrono::milliseconds timeout) {
+    auto until = std::chrono::steady_clock::now() + timeout;
+    deadline = until.time_since_epoch().count();
+    discarding = mode == ShutdownMode::Discard;
+    std::size_t resolved_before = resolved;
+    std::size_t dropped_before = dropped;
+
+    if (worker.joinable()) {
+        worker.request_stop();
+        worker.join();
+    } else {
+        std::stop_source source;
+        source.request_stop();
+        run(source.get_token());
+    }
+
+    ShutdownReport report;
+    report.resolved = resolved - resolved_before;
+    report.dropped = dropped - dropped_before;
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        report.dropped_events.swap(doomed);
+    }
+    report.in_time = std::chrono::steady_clock::now() <= until;
+    return report;
+}
+
+bool wait_for_stop(std::stop_token stop, std::chrono::milliseconds period) {
+    std::mutex mtx;
+    std::condition_variable_any cv;
+    std::unique_lock<std::mutex> lck(mtx);
+    return !cv.wait_for(lck, stop, period, [&stop] { return stop.stop_requested(); });
+}
+
+void move_npcs(const std::vector<std::shared_ptr<NPC>>& npcs, int max_x, int max_y) {
+    for (auto& npc : npcs) {
+        if (!npc->is_alive())
+            continue;
+
+        int move_dist = npc->get_move_distance();
+        int shift_x = std::rand() % (2 * move_dist + 1) - move_dist;
+        int shift_y = std::rand() % (2 * move_dist + 1) - move_dist;
+
+        npc->move(shift_x, shift_y, max_x, max_y);
+    }
+}
+
+void queue_fights(const std::vector<std::shared_ptr<NPC>>& npcs, FightManager& manager) {
+    for (auto& attacker : npcs) {
+        if (!attacker->is_alive())
+            continue;
+
+        int kill_dist = attacker->get_kill_distance();
+
+        for (auto& defender : npcs) {
+            if (attacker == defender || !defender->is_alive())
+                continue;
+
+            if (attacker->is_close(defender, kill_dist))
+                manager.add_event({attacker, defender});
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "npc.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <queue>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+struct FightEvent {
+    std::shared_ptr<NPC> attacker;
+    std::shared_ptr<NPC> defender;
+};
+
+enum class ShutdownMode {
+    Drain,
+    Discard
+};
+
+struct ShutdownReport {
+    std::size_t resolved{0};
+    std::size_t dropped{0};
+    bool in_time{true};
+    // The dropped events themselves. Freeing a large backlog takes time of its own,
+    // so it happens wherever the caller lets the report go, not inside stop().
+    std::vector<std::queue<FightEvent>> dropped_events;
+};
+
+// Queue of fights found by the movement thread. Any number of threads may add
+// events and drain the queue at once: a drain takes the whole queue under the lock
+// and resolves the fights outside it. start() runs a worker that sleeps on a
+// condition variable until events arrive; stop() ends it within a deadline.
+class FightManager {
+private:
+    std::queue<FightEvent> events;
+    std::vector<std::queue<FightEvent>> doomed;
+    std::mutex mtx;
+    std::condition_variable_any ready;
+    std::jthread worker;
+    std::atomic<bool> discarding{false};
+    std::atomic<std::chrono::steady_clock::rep> deadline{0};
+    std::atomic<std::size_t> resolved{0};
+    std::atomic<std::size_t> dropped{0};
+
+    bool past_deadline() const;
+    // Resolves `taken` front to back until shutdown runs out of time; the rest stays in `taken`.
+    void resolve(std::queue<FightEvent>& taken, std::stop_token stop);
+    void run(std::stop_token stop);
+
+public:
+    static FightManager& get();
+
+    void add_event(FightEvent&& event);
+    // Resolves every event queued so far, returns how many were taken.
+    std::size_t drain();
+    std::size_t pending();
+
+    void start();
+    // Drain resolves what is queued until the deadline and drops the rest; Discard
+    // drops everything not already being resolved. The report counts only what this
+    // shutdown resolved and dropped, and hands the dropped events over. The manager
+    // can be started again.
+    ShutdownReport stop(ShutdownMode mode, std::chrono::milliseconds timeout);
+};
+
+// Waits for `period` unless stop is requested first; false once it is.
+bool wait_for_stop(std::stop_token stop, std::chrono::milliseconds period);
+
+void move_npcs(const std::vector<std::shared_ptr<NPC>>& npcs, int max_x, int max_y);
+// Queues a fight for every living pair within the attacker's kill distance.
+void queue_fights(const std::vector<std::shared_ptr<NPC>>& npcs, FightManager& manager);
@@ -0,0 +1,87 @@
+#include "footprint.h"
+#include "registry.h"
+
+#include <malloc.h>
+
+namespace {
+
+// Cycles through the registered types.
+NpcType type_at(int i) {
+    return NpcRegistry::types[i % NpcRegistry::types.size()];
+}
+
+struct SilentObserver : public IFightObserver {
+    void on_fight(const std::shared_ptr<NPC>, const std::shared_ptr<NPC>, bool) override {}
+};
+
+std::size_t heap_in_use() {
+    return mallinfo2().uordblks;
+}
+
+}
+
+double Footprint::per_entity() const {
+    return entities ? static_cast<double>(heap_bytes) / entities : 0.0;
+}
+
+Footprint measure_npc_footprint(int count) {
+    auto observer = std::make_shared<SilentObserver>();
+
+    Footprint result;
+    result.entities = count;
+    result.object_bytes = sizeof(Princess);
+
+    std::size_t before = heap_in_use();
+    {
+        std::vector<std::shared_ptr<NPC>> npcs;
+        npcs.reserve(count);
+
+        for (int i = 0; i < count; ++i) {
+            NpcType type = type_at(i);
+            std::string name = type_name(type) + "_" + std::to_string(i);
+            std::shared_ptr<NPC> npc = NpcRegistry::make(type, name, i % 50, i % 50);
+            npc->subscribe(observer);
+            npcs.push_back(npc);
+        }
+
+        result.heap_bytes = heap_in_use() - before;
+    }
+
+    return result;
+}
+
+Footprint measure_body_footprint(int count) {
+    Footprint result;
+    result.entities = count;
+    result.object_bytes = sizeof(Body);
+
+    std::size_t before = heap_in_use();
+    {
+        WorldConfig config;
+        World world(config);
+        world.reserve(count);
+        for (int i = 0; i < count; ++i)
+            world.spawn(type_at(i), i % 50, i % 50);
+
+        result.heap_bytes = heap_in_use() - before;
+    }
+
+    return result;
+}
+
+void print_memory_report(std::ostream& os, int count) {
+    Footprint npc = measure_npc_footprint(count);
+    Footprint body = measure_body_footprint(count);
+
+    os << "=== ПАМЯТЬ НА " << count << " NPC ===\n";
+    os << "NPC (shared_ptr): sizeof " << npc.object_bytes << " байт"
+       << " [string " << sizeof(std::string)
+       << ", observers " << sizeof(std::vector<std::shared_ptr<IFightObserver>>)
+       << ", mutex " << sizeof(std::mutex)
+       << ", enable_shared_from_this " << sizeof(std::enable_shared_from_this<NPC>) << "]"
+       << ", в куче " << npc.per_entity() << " байт/NPC\n";
+    os << "Body (компактный): sizeof " << body.object_bytes << " байт"
+       << ", в куче " << body.per_entity() << " байт/NPC\n";
+    if (body.heap_bytes)
+        os << "Экономия: в " << static_cast<double>(npc.heap_bytes) / body.heap_bytes << " раз\n";
+}
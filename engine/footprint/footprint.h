@@ -0,0 +1,20 @@
+#pragma once
+
+#include "world.h"
+
+#include <iostream>
+
+struct Footprint {
+    std::size_t entities{0};
+    std::size_t object_bytes{0};
+    std::size_t heap_bytes{0};
+
+    double per_entity() const;
+};
+
+// Heap growth is measured with mallinfo2 while the population is built, so it
+// includes allocator overhead, control blocks, name buffers and observer lists.
+Footprint measure_npc_footprint(int count);
+Footprint measure_body_footprint(int count);
+
+void print_memory_report(std::ostream& os, int count);
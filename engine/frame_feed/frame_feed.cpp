@@ -0,0 +1,175 @@
+#include "frame_feed.h"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+constexpr std::uint32_t FrameMagic = 0x48573746;
+
+std::size_t slot_size(std::uint32_t capacity) {
+    std::size_t bytes = sizeof(FrameSlotHeader) + capacity * sizeof(Body);
+    return (bytes + 63) / 64 * 64;
+}
+
+std::size_t header_size() {
+    return (sizeof(FrameRingHeader) + 63) / 64 * 64;
+}
+
+FrameRingHeader* ring(void* memory) {
+    return static_cast<FrameRingHeader*>(memory);
+}
+
+FrameSlotHeader* slot(void* memory, std::uint64_t frame) {
+    FrameRingHeader* h = ring(memory);
+    char* base = static_cast<char*>(memory) + header_size();
+    return reinterpret_cast<FrameSlotHeader*>(base + (frame % h->slots) * slot_size(h->capacity));
+}
+
+Body* slot_bodies(FrameSlotHeader* s) {
+    return reinterpret_cast<Body*>(reinterpret_cast<char*>(s) + sizeof(FrameSlotHeader));
+}
+
+// Whether the ring the header describes lies within `size` mapped bytes.
+bool ring_fits(void* memory, std::size_t size) {
+    FrameRingHeader* h = ring(memory);
+    return h->slots > 0 && header_size() + std::uint64_t{h->slots} * slot_size(h->capacity) <= size;
+}
+
+// Inode of the object currently under `name`, 0 if there is none.
+ino_t object_of(const std::string& name) {
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return 0;
+    struct stat st{};
+    ino_t result = ::fstat(fd, &st) == 0 ? st.st_ino : 0;
+    ::close(fd);
+    return result;
+}
+
+}
+
+FramePublisher::FramePublisher(const std::string& n, std::uint32_t capacity, std::uint32_t slots) : name(n) {
+    slots = std::max(slots, 1u);
+    size = header_size() + slots * slot_size(capacity);
+
+    // A viewer may still map an object a crashed publisher left behind; it keeps
+    // its old mapping while the name goes to a new object.
+    ::shm_unlink(name.c_str());
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+        throw std::runtime_error("frame feed: shm_open failed for " + name);
+    struct stat st{};
+    if (::ftruncate(fd, size) < 0 || ::fstat(fd, &st) < 0) {
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        throw std::runtime_error("frame feed: ftruncate failed for " + name);
+    }
+    object = st.st_ino;
+
+    memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("frame feed: mmap failed for " + name);
+
+    std::memset(memory, 0, size);
+    FrameRingHeader* h = ring(memory);
+    h->slots = slots;
+    h->capacity = capacity;
+    h->open.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    h->magic = FrameMagic;
+}
+
+FramePublisher::~FramePublisher() {
+    ring(memory)->open.store(0, std::memory_order_release);
+    ::munmap(memory, size);
+    if (object_of(name) == object)
+        ::shm_unlink(name.c_str());
+}
+
+void FramePublisher::publish(int tick, const WorldConfig& config, const std::vector<Body>& bodies) {
+    FrameRingHeader* h = ring(memory);
+    FrameSlotHeader* s = slot(memory, next);
+
+    s->sequence.store(2 * next + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s->tick = tick;
+    s->count = static_cast<std::uint32_t>(std::min<std::size_t>(bodies.size(), h->capacity));
+    s->map_x = config.map_x;
+    s->map_y = config.map_y;
+    std::memcpy(slot_bodies(s), bodies.data(), s->count * sizeof(Body));
+
+    s->sequence.store(2 * next + 2, std::memory_order_release);
+    h->latest.store(next + 1, std::memory_order_release);
+    ++next;
+}
+
+FrameSubscriber::FrameSubscriber(const std::string& n) : name(n) {
+    int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return;
+
+    struct stat st{};
+    if (::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= header_size()) {
+        void* m = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (m != MAP_FAILED) {
+            if (ring(m)->magic == FrameMagic) {
+                memory = m;
+                size = st.st_size;
+                object = st.st_ino;
+            } else {
+                ::munmap(m, st.st_size);
+            }
+        }
+    }
+    ::close(fd);
+}
+
+FrameSubscriber::~FrameSubscriber() {
+    if (memory)
+        ::munmap(memory, size);
+}
+
+bool FrameSubscriber::attached() const {
+    return memory != nullptr;
+}
+
+bool FrameSubscriber::publisher_open() const {
+    return memory && ring(memory)->open.load(std::memory_order_acquire) && object_of(name) == object;
+}
+
+bool FrameSubscriber::read(Frame& frame) {
+    if (!memory || !ring_fits(memory, size))
+        return false;
+
+    std::uint64_t latest = ring(memory)->latest.load(std::memory_order_acquire);
+    if (latest == 0 || latest == last)
+        return false;
+
+    std::uint64_t number = latest - 1;
+    FrameSlotHeader* s = slot(memory, number);
+
+    std::uint64_t before = s->sequence.load(std::memory_order_acquire);
+    if (before != 2 * number + 2)
+        return false;
+
+    frame.number = number;
+    frame.tick = s->tick;
+    frame.map_x = s->map_x;
+    frame.map_y = s->map_y;
+    frame.bodies.resize(std::min(s->count, ring(memory)->capacity));
+    std::memcpy(frame.bodies.data(), slot_bodies(s), frame.bodies.size() * sizeof(Body));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s->sequence.load(std::memory_order_relaxed) != before)
+        return false;
+
+    last = latest;
+    return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "world.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+// Shared-memory ring of world snapshots. The simulation writes, any number of viewer
+// processes read; a writer never waits for readers and readers only ever see the
+// newest complete frame, so frames they are too slow for are simply skipped.
+//
+// Every publisher creates a fresh object under the name, replacing one left behind by
+// a publisher that crashed, so a viewer mapping never changes size under its reader;
+// the viewer notices the replacement through publisher_open() and attaches again.
+
+struct FrameRingHeader {
+    std::uint32_t magic;
+    std::uint32_t slots;
+    std::uint32_t capacity;
+    std::atomic<std::uint32_t> open;
+    std::atomic<std::uint64_t> latest;
+};
+
+// sequence is odd while the slot is being written and 2 * (frame + 1) once it is complete.
+struct FrameSlotHeader {
+    std::atomic<std::uint64_t> sequence;
+    std::int32_t tick;
+    std::uint32_t count;
+    std::int32_t map_x;
+    std::int32_t map_y;
+};
+
+struct Frame {
+    std::uint64_t number{0};
+    int tick{0};
+    int map_x{0};
+    int map_y{0};
+    std::vector<Body> bodies;
+};
+
+class FramePublisher {
+private:
+    std::string name;
+    void* memory{nullptr};
+    std::size_t size{0};
+    std::uint64_t next{0};
+    ino_t object{0};
+
+public:
+    FramePublisher(const std::string& name, std::uint32_t capacity, std::uint32_t slots = 4);
+    ~FramePublisher();
+
+    FramePublisher(const FramePublisher&) = delete;
+    FramePublisher& operator=(const FramePublisher&) = delete;
+
+    void publish(int tick, const WorldConfig& config, const std::vector<Body>& bodies);
+};
+
+class FrameSubscriber {
+private:
+    std::string name;
+    void* memory{nullptr};
+    std::size_t size{0};
+    std::uint64_t last{0};
+    ino_t object{0};
+
+public:
+    explicit FrameSubscriber(const std::string& name);
+    ~FrameSubscriber();
+
+    FrameSubscriber(const FrameSubscriber&) = delete;
+    FrameSubscriber& operator=(const FrameSubscriber&) = delete;
+
+    bool attached() const;
+    // False once the publisher closed the feed or another one replaced it under the name.
+    bool publisher_open() const;
+
+    // Copies the newest frame not seen yet; false if there is none, the writer lapped us
+    // or the header describes a ring larger than the mapping.
+    bool read(Frame& frame);
+};
@@ -0,0 +1,38 @@
+#include "observers.h"
+#include "render.h"
+
+std::shared_ptr<IFightObserver> TextObserver::get() {
+    static TextObserver instance;
+    return std::shared_ptr<IFightObserver>(&instance, [](IFightObserver*) {});
+}
+
+void TextObserver::on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win) {
+    if (win) {
+        std::lock_guard<std::mutex> lck(print_mutex);
+        std::cout << "\n" << "Убийца --------" << "\n";
+        attacker->print(std::cout);
+        defender->print(std::cout);
+    }
+}
+
+FileObserver::FileObserver() {
+    fs.open("log.txt");
+}
+
+FileObserver::~FileObserver() {
+    fs.close();
+}
+
+std::shared_ptr<IFightObserver> FileObserver::get() {
+    static FileObserver instance;
+    return std::shared_ptr<IFightObserver>(&instance, [](IFightObserver*) {});
+}
+
+void FileObserver::on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win) {
+    if (win) {
+        std::lock_guard<std::mutex> lck(mtx);
+        fs << "\n" << "Убийца --------" << "\n";
+        attacker->print(fs);
+        defender->print(fs);
+    }
+}
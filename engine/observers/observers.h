@@ -0,0 +1,30 @@
+#pragma once
+
+#include "npc.h"
+
+#include <fstream>
+
+// Prints every kill to std::cout under print_mutex.
+class TextObserver : public IFightObserver {
+private:
+    TextObserver() {}
+
+public:
+    static std::shared_ptr<IFightObserver> get();
+
+    void on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win) override;
+};
+
+// Appends every kill to log.txt.
+class FileObserver : public IFightObserver {
+private:
+    std::ofstream fs;
+    std::mutex mtx;
+    FileObserver();
+
+public:
+    ~FileObserver();
+    static std::shared_ptr<IFightObserver> get();
+
+    void on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win) override;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Below this many items a part, starting a thread costs more than it saves.
+constexpr std::size_t MinItemsPerThread = 1 << 16;
+
+// Number of parts to split `count` items into on `threads` threads, all cores if 0.
+inline std::size_t parallel_parts(std::size_t count, unsigned threads) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    return std::min<std::size_t>(threads, std::max<std::size_t>(1, count / MinItemsPerThread));
+}
+
+// Calls work(part, from, to) for `parts` contiguous ranges covering [0, count), one
+// thread per part, and returns once all are done. A single part runs on the caller.
+template <class Work>
+void parallel_for(std::size_t count, std::size_t parts, Work&& work) {
+    if (parts <= 1) {
+        work(std::size_t{0}, std::size_t{0}, count);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    for (std::size_t p = 0; p < parts; ++p)
+        pool.emplace_back([&work, p, count, parts] { work(p, count * p / parts, count * (p + 1) / parts); });
+    for (auto& t : pool)
+        t.join();
+}
@@ -0,0 +1,155 @@
+#include "region_stats.h"
+#include "fight.h"
+#include "parallel.h"
+
+#include <thread>
+
+RegionStats::RegionStats(const WorldConfig& config, int grid_x, int grid_y, unsigned t)
+    : cfg(config), gx_count(std::max(grid_x, 1)), gy_count(std::max(grid_y, 1)), threads(t),
+      counts(gx_count * gy_count * NpcRegistry::size, 0), kill_counts(gx_count * gy_count, 0) {}
+
+int RegionStats::cell_of(int x, int y) const {
+    int gx = std::clamp(x * gx_count / std::max(cfg.map_x, 1), 0, gx_count - 1);
+    int gy = std::clamp(y * gy_count / std::max(cfg.map_y, 1), 0, gy_count - 1);
+    return gx + gy * gx_count;
+}
+
+void RegionStats::update(const std::vector<Body>& bodies) {
+    std::size_t cells = counts.size();
+    std::size_t parts = parallel_parts(bodies.size(), threads);
+
+    auto histogram = [&](std::vector<std::uint32_t>& out, std::size_t from, std::size_t to) {
+        for (std::size_t i = from; i < to; ++i) {
+            const Body& body = bodies[i];
+            if (body.alive)
+                ++out[cell_of(body.x, body.y) * NpcRegistry::size + body.type];
+        }
+    };
+
+    if (parts <= 1) {
+        std::fill(counts.begin(), counts.end(), 0);
+        histogram(counts, 0, bodies.size());
+    } else {
+        std::vector<std::vector<std::uint32_t>> partial(parts, std::vector<std::uint32_t>(cells, 0));
+        parallel_for(bodies.size(), parts, [&](std::size_t p, std::size_t from, std::size_t to) {
+            histogram(partial[p], from, to);
+        });
+
+        std::vector<std::thread> pool;
+        for (std::size_t stride = 1; stride < parts; stride *= 2) {
+            pool.clear();
+            for (std::size_t p = 0; p + stride < parts; p += 2 * stride) {
+                pool.emplace_back([&partial, p, stride, cells] {
+                    auto& into = partial[p];
+                    const auto& from = partial[p + stride];
+                    for (std::size_t c = 0; c < cells; ++c)
+                        into[c] += from[c];
+                });
+            }
+            for (auto& t : pool)
+                t.join();
+        }
+
+        counts.swap(partial[0]);
+    }
+
+    totals.fill(0);
+    for (std::size_t c = 0; c < cells; ++c)
+        totals[c % NpcRegistry::size] += counts[c];
+}
+
+void RegionStats::on_kill([[maybe_unused]] int tick, [[maybe_unused]] const Body& attacker, const Body& defender) {
+    ++kill_counts[cell_of(defender.x, defender.y)];
+}
+
+void RegionStats::clear_kills() {
+    std::fill(kill_counts.begin(), kill_counts.end(), 0);
+}
+
+int RegionStats::grid_x() const {
+    return gx_count;
+}
+
+int RegionStats::grid_y() const {
+    return gy_count;
+}
+
+std::uint32_t RegionStats::count(int cell, NpcType type) const {
+    return counts[cell * NpcRegistry::size + type];
+}
+
+std::uint32_t RegionStats::kills(int cell) const {
+    return kill_counts[cell];
+}
+
+std::uint64_t RegionStats::total(NpcType type) const {
+    return totals[type];
+}
+
+double RegionStats::predator_prey_ratio(int cell) const {
+    std::uint32_t predators = 0, prey = 0;
+    for (NpcType type : NpcRegistry::types) {
+        if (is_predator(type))
+            predators += count(cell, type);
+        if (is_prey(type))
+            prey += count(cell, type);
+    }
+    return prey ? static_cast<double>(predators) / prey : 0.0;
+}
+
+NpcType RegionStats::dominant(int cell) const {
+    NpcType result = Unknown;
+    std::uint32_t best = 0;
+    for (NpcType type : NpcRegistry::types) {
+        if (count(cell, type) > 0 && count(cell, type) >= best) {
+            best = count(cell, type);
+            result = type;
+        }
+    }
+    return result;
+}
+
+void RegionStats::export_csv_header(std::ostream& os) {
+    os << "tick,gx,gy,";
+    for (NpcType type : NpcRegistry::types)
+        os << NpcRegistry::column[type] << ",";
+    os << "kills,predator_prey_ratio\n";
+}
+
+void RegionStats::export_csv(std::ostream& os, int tick) const {
+    for (int gy = 0; gy < gy_count; ++gy) {
+        for (int gx = 0; gx < gx_count; ++gx) {
+            int cell = gx + gy * gx_count;
+            if (dominant(cell) == Unknown && kills(cell) == 0)
+                continue;
+            os << tick << "," << gx << "," << gy << ",";
+            for (NpcType type : NpcRegistry::types)
+                os << count(cell, type) << ",";
+            os << kills(cell) << "," << predator_prey_ratio(cell) << "\n";
+        }
+    }
+}
+
+void draw_regions(std::ostream& os, const RegionStats& stats, std::size_t population) {
+    os << "\n";
+
+    for (int y = 0; y < stats.grid_y(); ++y) {
+        for (int x = 0; x < stats.grid_x(); ++x) {
+            NpcType type = stats.dominant(x + y * stats.grid_x());
+
+            if (type != Unknown)
+                os << "|" << color_code(type) << symbol(type) << "\033[0m|";
+            else
+                os << "| |";
+        }
+        os << "\n";
+    }
+    os << std::string(stats.grid_x() * 3, '=') << "\n";
+
+    std::uint64_t alive = 0;
+    for (NpcType type : NpcRegistry::types) {
+        os << NpcRegistry::color[type] << NpcRegistry::title[type] << ": " << stats.total(type) << "\033[0m | ";
+        alive += stats.total(type);
+    }
+    os << "Всего: " << alive << "/" << population << "\n";
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "world.h"
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Per-cell population and kill counts at any grid resolution. Large populations
+// are histogrammed by several threads into private grids which are then summed
+// pairwise, so nothing is shared while counting.
+class RegionStats : public IKillObserver {
+private:
+    WorldConfig cfg;
+    int gx_count;
+    int gy_count;
+    unsigned threads;
+    std::vector<std::uint32_t> counts;
+    std::vector<std::uint32_t> kill_counts;
+    NpcRegistry::Table<std::uint64_t> totals{};
+
+public:
+    RegionStats(const WorldConfig& config, int grid_x, int grid_y, unsigned threads = 0);
+
+    void update(const std::vector<Body>& bodies);
+    void on_kill(int tick, const Body& attacker, const Body& defender) override;
+    void clear_kills();
+
+    int grid_x() const;
+    int grid_y() const;
+    int cell_of(int x, int y) const;
+
+    std::uint32_t count(int cell, NpcType type) const;
+    std::uint32_t kills(int cell) const;
+    std::uint64_t total(NpcType type) const;
+    // Predators over prey in the cell, 0 if there is no prey.
+    double predator_prey_ratio(int cell) const;
+    // Type with the most living members in the cell, Unknown if it is empty.
+    NpcType dominant(int cell) const;
+
+    static void export_csv_header(std::ostream& os);
+    void export_csv(std::ostream& os, int tick) const;
+};
+
+// ANSI map in the draw_map format, one symbol per cell for its dominant type.
+void draw_regions(std::ostream& os, const RegionStats& stats, std::size_t population);
@@ -0,0 +1,28 @@
+#include "render.h"
+#include "region_stats.h"
+
+std::mutex print_mutex;
+
+std::vector<Body> snapshot_bodies(const std::vector<std::shared_ptr<NPC>>& npcs) {
+    std::vector<Body> snapshot;
+    snapshot.reserve(npcs.size());
+
+    for (const auto& npc : npcs) {
+        Body body;
+        body.id = static_cast<std::uint32_t>(snapshot.size());
+        std::tie(body.x, body.y) = npc->position();
+        body.type = npc->type;
+        body.alive = npc->is_alive();
+        snapshot.push_back(body);
+    }
+
+    return snapshot;
+}
+
+void draw_map(const std::vector<std::shared_ptr<NPC>>& npcs, const WorldConfig& config, int grid) {
+    RegionStats stats(config, grid, grid);
+    stats.update(snapshot_bodies(npcs));
+
+    std::lock_guard<std::mutex> lck(print_mutex);
+    draw_regions(std::cout, stats, npcs.size());
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "npc.h"
+#include "world.h"
+
+#include <mutex>
+
+// Serialises everything printed to std::cout by the interactive threads.
+extern std::mutex print_mutex;
+
+// Positions, types and alive flags of the NPCs, with their index as id.
+std::vector<Body> snapshot_bodies(const std::vector<std::shared_ptr<NPC>>& npcs);
+
+// Prints the map of the living NPCs with one cell per `grid` step.
+void draw_map(const std::vector<std::shared_ptr<NPC>>& npcs, const WorldConfig& config = {}, int grid = 25);
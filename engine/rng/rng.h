@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <utility>
+
+enum RollStream : std::uint64_t {
+    MoveStream = 1,
+    FightStream = 2,
+    SpawnStream = 3,
+    DriftStream = 4,
+    ClusterStream = 5
+};
+
+// Counter-based generator: every draw is a pure function of (seed, tick, a, b),
+// so any process that knows the same counters rolls the same dice.
+inline std::uint64_t mix64(std::uint64_t z) {
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+inline std::uint64_t roll(std::uint64_t seed, std::uint64_t tick, std::uint64_t a, std::uint64_t b) {
+    return mix64(seed ^ mix64(tick ^ mix64(a ^ mix64(b))));
+}
+
+inline int roll_range(std::uint64_t r, int lo, int hi) {
+    return lo + static_cast<int>(r % static_cast<std::uint64_t>(hi - lo + 1));
+}
+
+// Two independent standard normal draws from one roll (Box-Muller).
+inline std::pair<double, double> roll_normal(std::uint64_t r) {
+    double u1 = ((r & 0xffffffff) + 1.0) / 4294967297.0;
+    double u2 = (r >> 32) / 4294967296.0;
+    double magnitude = std::sqrt(-2.0 * std::log(u1));
+    double angle = 2.0 * std::numbers::pi * u2;
+    return {magnitude * std::cos(angle), magnitude * std::sin(angle)};
+}
@@ -0,0 +1,369 @@
+#include "shard.h"
+#include "fight.h"
+
+#include <stdexcept>
+#include <cstdint>
+#include <cerrno>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+namespace {
+
+using Header = std::uint64_t;
+
+Bytes frame(const Bytes& payload) {
+    Bytes result(sizeof(Header) + payload.size());
+    Header size = payload.size();
+    std::memcpy(result.data(), &size, sizeof(Header));
+    if (!payload.empty())
+        std::memcpy(result.data() + sizeof(Header), payload.data(), payload.size());
+    return result;
+}
+
+void write_all(int fd, const Bytes& bytes) {
+    std::size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t n = ::send(fd, bytes.data() + done, bytes.size() - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            throw std::runtime_error("shard: write failed");
+        done += n;
+    }
+}
+
+void read_exact(int fd, char* data, std::size_t size) {
+    std::size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::recv(fd, data + done, size - done, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            throw std::runtime_error("shard: read failed");
+        done += n;
+    }
+}
+
+Bytes read_message(int fd) {
+    Header size = 0;
+    read_exact(fd, reinterpret_cast<char*>(&size), sizeof(Header));
+    Bytes result(size);
+    read_exact(fd, result.data(), size);
+    return result;
+}
+
+}
+
+FdTransport::FdTransport(int rank, std::vector<int> peer_fds) : my_rank(rank), fds(std::move(peer_fds)) {}
+
+FdTransport::~FdTransport() {
+    for (int fd : fds)
+        if (fd >= 0)
+            ::close(fd);
+}
+
+int FdTransport::rank() const {
+    return my_rank;
+}
+
+int FdTransport::size() const {
+    return static_cast<int>(fds.size());
+}
+
+std::vector<Bytes> FdTransport::exchange(const std::vector<Bytes>& out) {
+    int n = size();
+
+    std::vector<Bytes> sending(n);
+    std::vector<std::size_t> sent(n, 0);
+    std::vector<Bytes> in(n);
+    std::vector<Header> header(n, 0);
+    std::vector<std::size_t> received(n, 0);
+    std::vector<bool> has_header(n, false);
+
+    int pending = 0;
+    for (int peer = 0; peer < n; ++peer) {
+        if (peer == my_rank)
+            continue;
+        sending[peer] = frame(out[peer]);
+        pending += 2;
+    }
+
+    // Every peer writes and reads at once, so both directions are multiplexed
+    // with poll() to keep a full socket buffer from deadlocking the ring.
+    while (pending > 0) {
+        std::vector<pollfd> pfds;
+        std::vector<int> peers;
+        for (int peer = 0; peer < n; ++peer) {
+            if (peer == my_rank)
+                continue;
+            short events = 0;
+            if (sent[peer] < sending[peer].size())
+                events |= POLLOUT;
+            if (!has_header[peer] || received[peer] < header[peer])
+                events |= POLLIN;
+            if (events) {
+                pfds.push_back({fds[peer], events, 0});
+                peers.push_back(peer);
+            }
+        }
+
+        if (::poll(pfds.data(), pfds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("shard: poll failed");
+        }
+
+        for (std::size_t i = 0; i < pfds.size(); ++i) {
+            int peer = peers[i];
+            int fd = pfds[i].fd;
+
+            if (pfds[i].revents & POLLOUT) {
+                ssize_t n_sent = ::send(fd, sending[peer].data() + sent[peer], sending[peer].size() - sent[peer], MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (n_sent < 0 && errno != EAGAIN && errno != EINTR)
+                    throw std::runtime_error("shard: send failed");
+                if (n_sent > 0) {
+                    sent[peer] += n_sent;
+                    if (sent[peer] == sending[peer].size())
+                        --pending;
+                }
+            }
+
+            bool reading = !has_header[peer] || received[peer] < header[peer];
+            if (reading && (pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                char* target;
+                std::size_t want;
+                if (!has_header[peer]) {
+                    target = reinterpret_cast<char*>(&header[peer]) + received[peer];
+                    want = sizeof(Header) - received[peer];
+                } else {
+                    target = in[peer].data() + received[peer];
+                    want = header[peer] - received[peer];
+                }
+
+                ssize_t n_read = ::recv(fd, target, want, MSG_DONTWAIT);
+                if (n_read == 0)
+                    throw std::runtime_error("shard: peer closed connection");
+                if (n_read < 0 && errno != EAGAIN && errno != EINTR)
+                    throw std::runtime_error("shard: recv failed");
+                if (n_read > 0)
+                    received[peer] += n_read;
+
+                if (!has_header[peer] && received[peer] == sizeof(Header)) {
+                    has_header[peer] = true;
+                    received[peer] = 0;
+                    in[peer].resize(header[peer]);
+                }
+                if (has_header[peer] && received[peer] == header[peer])
+                    --pending;
+            }
+        }
+    }
+
+    return in;
+}
+
+bool ShardRect::contains(int x, int y) const {
+    return x >= x0 && x <= x1 && y >= y0 && y <= y1;
+}
+
+bool ShardRect::near(int x, int y, int distance) const {
+    int dx = std::max({x0 - x, 0, x - x1});
+    int dy = std::max({y0 - y, 0, y - y1});
+    return dx * dx + dy * dy <= distance * distance;
+}
+
+int ShardLayout::count() const {
+    return shards_x * shards_y;
+}
+
+int ShardLayout::owner(const WorldConfig& config, int x, int y) const {
+    int sx = x * shards_x / (config.map_x + 1);
+    int sy = y * shards_y / (config.map_y + 1);
+    return sx + sy * shards_x;
+}
+
+ShardRect ShardLayout::rect(const WorldConfig& config, int shard) const {
+    int w = config.map_x + 1;
+    int h = config.map_y + 1;
+    int sx = shard % shards_x;
+    int sy = shard / shards_x;
+
+    auto first = [](int i, int size, int parts) { return (i * size + parts - 1) / parts; };
+
+    return {first(sx, w, shards_x), first(sy, h, shards_y),
+            first(sx + 1, w, shards_x) - 1, first(sy + 1, h, shards_y) - 1};
+}
+
+ShardWorker::ShardWorker(const WorldConfig& config, const ShardLayout& l, ITransport& t, const std::vector<Body>& initial)
+    : cfg(config), layout(l), transport(t) {
+    for (const auto& body : initial)
+        if (layout.owner(cfg, body.x, body.y) == transport.rank())
+            owned.push_back(body);
+}
+
+void ShardWorker::step() {
+    int me = transport.rank();
+    int n = transport.size();
+
+    for (auto& body : owned)
+        if (body.alive)
+            move_body(body, cfg, current_tick);
+
+    std::vector<std::vector<Body>> leaving(n);
+    std::vector<Body> staying;
+    for (const auto& body : owned) {
+        int to = layout.owner(cfg, body.x, body.y);
+        if (body.alive && to != me)
+            leaving[to].push_back(body);
+        else
+            staying.push_back(body);
+    }
+
+    std::vector<Bytes> out(n);
+    for (int peer = 0; peer < n; ++peer)
+        out[peer] = pack_bodies(leaving[peer]);
+
+    auto arrived = transport.exchange(out);
+    owned = std::move(staying);
+    for (int peer = 0; peer < n; ++peer) {
+        if (peer == me)
+            continue;
+        auto bodies = unpack_bodies(arrived[peer]);
+        owned.insert(owned.end(), bodies.begin(), bodies.end());
+    }
+
+    int halo = max_kill_distance();
+    for (int peer = 0; peer < n; ++peer) {
+        if (peer == me)
+            continue;
+        ShardRect r = layout.rect(cfg, peer);
+        std::vector<Body> border;
+        for (const auto& body : owned)
+            if (body.alive && r.near(body.x, body.y, halo))
+                border.push_back(body);
+        out[peer] = pack_bodies(border);
+    }
+
+    auto halos = transport.exchange(out);
+    std::vector<Body> work = owned;
+    for (int peer = 0; peer < n; ++peer) {
+        if (peer == me)
+            continue;
+        auto bodies = unpack_bodies(halos[peer]);
+        work.insert(work.end(), bodies.begin(), bodies.end());
+    }
+
+    for (const auto& kill : find_kills(cfg, current_tick, work, owned.size()))
+        owned[kill.defender].alive = false;
+
+    ++current_tick;
+}
+
+int ShardWorker::tick() const {
+    return current_tick;
+}
+
+const std::vector<Body>& ShardWorker::bodies() const {
+    return owned;
+}
+
+Bytes pack_bodies(const std::vector<Body>& bodies) {
+    Bytes result(bodies.size() * sizeof(Body));
+    if (!bodies.empty())
+        std::memcpy(result.data(), bodies.data(), result.size());
+    return result;
+}
+
+std::vector<Body> unpack_bodies(const Bytes& bytes) {
+    std::vector<Body> result(bytes.size() / sizeof(Body));
+    if (!result.empty())
+        std::memcpy(result.data(), bytes.data(), result.size() * sizeof(Body));
+    return result;
+}
+
+std::vector<Body> run_sharded(const WorldConfig& config, const ShardLayout& layout, const std::vector<Body>& initial, int ticks) {
+    int n = layout.count();
+
+    std::vector<std::vector<int>> mesh(n, std::vector<int>(n, -1));
+    for (int i = 0; i < n; ++i) {
+        for (int j = i + 1; j < n; ++j) {
+            int sv[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+                throw std::runtime_error("shard: socketpair failed");
+            mesh[i][j] = sv[0];
+            mesh[j][i] = sv[1];
+        }
+    }
+
+    std::vector<int> results(n, -1);
+    std::vector<pid_t> children;
+
+    for (int rank = 0; rank < n; ++rank) {
+        int sv[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+            throw std::runtime_error("shard: socketpair failed");
+
+        pid_t pid = ::fork();
+        if (pid < 0)
+            throw std::runtime_error("shard: fork failed");
+
+        if (pid == 0) {
+            ::close(sv[0]);
+            for (int i = 0; i < n; ++i)
+                for (int j = 0; j < n; ++j)
+                    if (i != rank && mesh[i][j] >= 0)
+                        ::close(mesh[i][j]);
+            for (int i = 0; i < rank; ++i)
+                ::close(results[i]);
+
+            int status = 0;
+            try {
+                FdTransport transport(rank, mesh[rank]);
+                ShardWorker worker(config, layout, transport, initial);
+                for (int t = 0; t < ticks; ++t)
+                    worker.step();
+                write_all(sv[1], frame(pack_bodies(worker.bodies())));
+            } catch (...) {
+                status = 1;
+            }
+            ::_exit(status);
+        }
+
+        ::close(sv[1]);
+        results[rank] = sv[0];
+        children.push_back(pid);
+    }
+
+    for (auto& row : mesh)
+        for (int fd : row)
+            if (fd >= 0)
+                ::close(fd);
+
+    std::vector<Body> result;
+    bool failed = false;
+    for (int rank = 0; rank < n; ++rank) {
+        try {
+            auto bodies = unpack_bodies(read_message(results[rank]));
+            result.insert(result.end(), bodies.begin(), bodies.end());
+        } catch (const std::runtime_error&) {
+            failed = true;
+        }
+        ::close(results[rank]);
+    }
+
+    for (pid_t pid : children) {
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failed = true;
+    }
+
+    if (failed)
+        throw std::runtime_error("shard: worker process failed");
+
+    std::sort(result.begin(), result.end(), [](const Body& a, const Body& b) { return a.id < b.id; });
+    return result;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "world.h"
+
+#include <vector>
+
+using Bytes = std::vector<char>;
+
+// All-to-all message exchange between the shard processes of one run.
+struct ITransport {
+    virtual ~ITransport() = default;
+
+    virtual int rank() const = 0;
+    virtual int size() const = 0;
+
+    // out[peer] is delivered to peer, the result holds one message from every peer.
+    // out[rank()] and the result's own slot are unused.
+    virtual std::vector<Bytes> exchange(const std::vector<Bytes>& out) = 0;
+};
+
+// Works over any connected stream socket: socketpair() today, TCP later.
+class FdTransport : public ITransport {
+private:
+    int my_rank;
+    std::vector<int> fds;
+
+public:
+    FdTransport(int rank, std::vector<int> peer_fds);
+    ~FdTransport() override;
+
+    FdTransport(const FdTransport&) = delete;
+    FdTransport& operator=(const FdTransport&) = delete;
+
+    int rank() const override;
+    int size() const override;
+    std::vector<Bytes> exchange(const std::vector<Bytes>& out) override;
+};
+
+struct ShardRect {
+    int x0, y0, x1, y1;
+
+    bool contains(int x, int y) const;
+    bool near(int x, int y, int distance) const;
+};
+
+struct ShardLayout {
+    int shards_x{1};
+    int shards_y{1};
+
+    int count() const;
+    int owner(const WorldConfig& config, int x, int y) const;
+    ShardRect rect(const WorldConfig& config, int shard) const;
+};
+
+class ShardWorker {
+private:
+    WorldConfig cfg;
+    ShardLayout layout;
+    ITransport& transport;
+    int current_tick{0};
+    std::vector<Body> owned;
+
+public:
+    ShardWorker(const WorldConfig& config, const ShardLayout& layout, ITransport& transport, const std::vector<Body>& initial);
+
+    void step();
+
+    int tick() const;
+    const std::vector<Body>& bodies() const;
+};
+
+Bytes pack_bodies(const std::vector<Body>& bodies);
+std::vector<Body> unpack_bodies(const Bytes& bytes);
+
+// Forks one worker process per shard, runs them for the given number of ticks and
+// returns the final state of every body ordered by id.
+std::vector<Body> run_sharded(const WorldConfig& config, const ShardLayout& layout, const std::vector<Body>& initial, int ticks);
@@ -0,0 +1,125 @@
+#include "spawn.h"
+#include "parallel.h"
+
+#include <fstream>
+#include <stdexcept>
+
+Placement placement_from_name(const std::string& name) {
+    if (name == "uniform")
+        return Placement::Uniform;
+    if (name == "clusters")
+        return Placement::Clustered;
+    if (name == "file")
+        return Placement::FromFile;
+    throw std::runtime_error("spawn: unknown placement " + name);
+}
+
+NpcRegistry::Table<std::uint32_t> split_counts(std::uint32_t total, const PopulationMix& mix) {
+    check_mix(mix);
+    NpcRegistry::Table<std::uint32_t> counts{};
+
+    std::uint64_t weights = 0;
+    for (int weight : mix)
+        weights += weight;
+
+    std::uint32_t given = 0;
+    NpcType last = Unknown;
+    for (NpcType type : NpcRegistry::types) {
+        counts[type] = static_cast<std::uint32_t>(std::uint64_t(total) * mix[type] / weights);
+        given += counts[type];
+        if (mix[type] > 0)
+            last = type;
+    }
+    counts[last] += total - given;
+
+    return counts;
+}
+
+std::vector<std::pair<int, int>> load_points(const std::string& path) {
+    std::ifstream is(path);
+    if (!is)
+        throw std::runtime_error("spawn: cannot open " + path);
+
+    std::vector<std::pair<int, int>> points;
+    int x, y;
+    while (is >> x >> y)
+        points.emplace_back(x, y);
+    if (!is.eof())
+        throw std::runtime_error("spawn: bad point in " + path);
+    if (points.empty())
+        throw std::runtime_error("spawn: no points in " + path);
+
+    return points;
+}
+
+void bulk_spawn(World& world, const SpawnPlan& plan, std::shared_ptr<IKillObserver> observer) {
+    const WorldConfig& cfg = world.config();
+
+    if (plan.counts[Unknown] > 0)
+        throw std::runtime_error("spawn: bodies of unknown type requested");
+
+    std::vector<std::pair<int, int>> points;
+    if (plan.placement == Placement::FromFile)
+        points = load_points(plan.file);
+
+    int clusters = std::max(plan.clusters, 1);
+    std::vector<std::pair<double, double>> centres;
+    if (plan.placement == Placement::Clustered)
+        for (int c = 0; c < clusters; ++c)
+            centres.emplace_back(roll_range(roll(cfg.seed ^ ClusterStream, 0, c, 0), 0, cfg.map_x),
+                                 roll_range(roll(cfg.seed ^ ClusterStream, 0, c, 1), 0, cfg.map_y));
+    double sigma = plan.spread * std::min(cfg.map_x, cfg.map_y);
+
+    std::uint64_t total = 0;
+    for (auto count : plan.counts)
+        total += count;
+
+    std::uint32_t first = static_cast<std::uint32_t>(world.bodies().size());
+    std::span<Body> bodies = world.extend(total);
+
+    // Bodies of one type are contiguous, in registry order; type_end[k] is the index
+    // after the last body of NpcRegistry::types[k].
+    constexpr auto& types = NpcRegistry::types;
+    std::array<std::uint64_t, types.size()> type_end{};
+    std::uint64_t end = 0;
+    for (std::size_t k = 0; k < types.size(); ++k)
+        type_end[k] = end += plan.counts[types[k]];
+
+    auto fill = [&](std::size_t, std::size_t from, std::size_t to) {
+        std::size_t k = 0;
+        for (std::size_t i = from; i < to; ++i) {
+            while (i >= type_end[k])
+                ++k;
+
+            Body& body = bodies[i];
+            body.id = first + static_cast<std::uint32_t>(i);
+            body.type = types[k];
+            body.alive = true;
+
+            switch (plan.placement) {
+            case Placement::Uniform:
+                body.x = roll_range(roll(cfg.seed ^ SpawnStream, 0, body.id, 1), 0, cfg.map_x);
+                body.y = roll_range(roll(cfg.seed ^ SpawnStream, 0, body.id, 2), 0, cfg.map_y);
+                break;
+            case Placement::Clustered: {
+                auto [cx, cy] = centres[roll(cfg.seed ^ SpawnStream, 0, body.id, 3) % centres.size()];
+                auto [nx, ny] = roll_normal(roll(cfg.seed ^ SpawnStream, 0, body.id, 4));
+                body.x = std::clamp(static_cast<int>(std::lround(cx + sigma * nx)), 0, cfg.map_x);
+                body.y = std::clamp(static_cast<int>(std::lround(cy + sigma * ny)), 0, cfg.map_y);
+                break;
+            }
+            case Placement::FromFile: {
+                auto [x, y] = points[body.id % points.size()];
+                body.x = std::clamp(x, 0, cfg.map_x);
+                body.y = std::clamp(y, 0, cfg.map_y);
+                break;
+            }
+            }
+        }
+    };
+
+    parallel_for(total, parallel_parts(total, plan.threads), fill);
+
+    if (observer)
+        world.subscribe(observer);
+}
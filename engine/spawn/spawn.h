@@ -0,0 +1,44 @@
+#pragma once
+
+#include "world.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class Placement {
+    Uniform,
+    Clustered,
+    FromFile
+};
+
+struct SpawnPlan {
+    // Bodies to create, indexed by NpcType.
+    NpcRegistry::Table<std::uint32_t> counts{};
+    Placement placement{Placement::Uniform};
+    // Clustered: number of Gaussian blobs and their standard deviation as a share
+    // of the smaller map side.
+    int clusters{8};
+    double spread{0.05};
+    // FromFile: "x y" per line, reused in a cycle when there are more bodies than points.
+    std::string file;
+    unsigned threads{0};
+};
+
+// "uniform", "clusters" or "file"; anything else throws.
+Placement placement_from_name(const std::string& name);
+
+// Splits `total` between the types by the weights in `mix`, checked with check_mix.
+NpcRegistry::Table<std::uint32_t> split_counts(std::uint32_t total, const PopulationMix& mix);
+
+std::vector<std::pair<int, int>> load_points(const std::string& path);
+
+// Appends every body of the plan to the world's storage, filled by several threads
+// in parallel. Ids continue from the current size and positions are rolled from the
+// world seed and the id, so the result does not depend on the thread count.
+// `observer`, if given, is subscribed once for the whole batch. Counts for Unknown
+// are rejected, as there is no type to give those bodies.
+void bulk_spawn(World& world, const SpawnPlan& plan, std::shared_ptr<IKillObserver> observer = nullptr);
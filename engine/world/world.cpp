@@ -0,0 +1,200 @@
+#include "world.h"
+#include "fight.h"
+#include "activity.h"
+#include "registry.h"
+
+#include <stdexcept>
+
+void move_body(Body& body, const WorldConfig& config, int tick) {
+    NpcRegistry::dispatch(body.type, [&]<class Object>() {
+        constexpr int move_dist = NpcTraits<Object>::speed;
+        std::uint64_t r = roll(config.seed, tick, body.id, MoveStream);
+
+        int shift_x = roll_range(r & 0xffffffff, -move_dist, move_dist);
+        int shift_y = roll_range(r >> 32, -move_dist, move_dist);
+
+        body.x = std::clamp(body.x + shift_x, 0, config.map_x);
+        body.y = std::clamp(body.y + shift_y, 0, config.map_y);
+    });
+}
+
+std::string body_name(const Body& body) {
+    return type_name(body.type) + "_" + std::to_string(body.id);
+}
+
+void check_mix(const PopulationMix& mix) {
+    long long total = 0;
+    for (int weight : mix) {
+        if (weight < 0)
+            throw std::runtime_error("mix: negative weight " + std::to_string(weight));
+        total += weight;
+    }
+    if (total == 0)
+        throw std::runtime_error("mix: all weights are 0");
+}
+
+std::vector<Body> random_population(const WorldConfig& config, int count, const PopulationMix& mix) {
+    check_mix(mix);
+
+    std::vector<Body> result;
+    result.reserve(count);
+
+    int total = 0;
+    for (int weight : mix)
+        total += weight;
+
+    for (int i = 0; i < count; ++i) {
+        std::uint64_t r = roll(config.seed ^ SpawnStream, 0, i, 0);
+        int pick = roll_range(r, 0, total - 1);
+        int type = 0;
+        while (pick >= mix[type])
+            pick -= mix[type++];
+
+        Body body;
+        body.id = static_cast<std::uint32_t>(i);
+        body.type = static_cast<NpcType>(type);
+        body.x = roll_range(roll(config.seed ^ SpawnStream, 0, i, 1), 0, config.map_x);
+        body.y = roll_range(roll(config.seed ^ SpawnStream, 0, i, 2), 0, config.map_y);
+        result.push_back(body);
+    }
+
+    return result;
+}
+
+World::World(const WorldConfig& config) : cfg(config) {}
+
+void World::reserve(std::size_t count) {
+    entities.reserve(count);
+}
+
+std::uint32_t World::spawn(NpcType type, int x, int y) {
+    Body body;
+    body.id = static_cast<std::uint32_t>(entities.size());
+    body.type = type;
+    body.x = x;
+    body.y = y;
+    entities.push_back(body);
+    return body.id;
+}
+
+void World::add(const Body& body) {
+    entities.push_back(body);
+}
+
+std::span<Body> World::extend(std::size_t count) {
+    std::size_t first = entities.size();
+    entities.resize(first + count);
+    return std::span<Body>(entities).subspan(first);
+}
+
+void World::subscribe(std::shared_ptr<IKillObserver> observer) {
+    observers.push_back(observer);
+}
+
+void World::restore(int tick, std::vector<Body> bodies) {
+    current_tick = tick;
+    entities = std::move(bodies);
+    if (activity)
+        track_activity();
+}
+
+void World::enable_sleeping(const SleepConfig& sleep) {
+    if (sleep.region > 0)
+        activity = std::make_shared<RegionActivity>(cfg, sleep);
+    else
+        activity.reset();
+}
+
+std::size_t World::sleeping_regions() const {
+    return activity && activity->ready() ? activity->sleeping() : 0;
+}
+
+void World::step() {
+    if (!activity) {
+        for (auto& body : entities)
+            if (body.alive)
+                move_body(body, cfg, current_tick);
+
+        apply_kills(find_kills(cfg, current_tick, entities, entities.size()));
+        ++current_tick;
+        return;
+    }
+
+    if (!activity->tracks(entities))
+        track_activity();
+
+    int stride = activity->stride();
+    activity->collect_moving(entities, moving);
+    activity->collect_due(entities, current_tick, dozing);
+
+    for (std::uint32_t i : moving) {
+        wake_body(entities[i], cfg, current_tick, stride, activity->phase_of(i));
+        move_body(entities[i], cfg, current_tick);
+        activity->relocate(i, entities[i]);
+    }
+    for (std::uint32_t i : dozing)
+        if (doze_body(entities[i], cfg, current_tick, stride, activity->phase_of(i)))
+            activity->relocate(i, entities[i]);
+
+    activity->refresh();
+    activity->collect_fighters(entities, attackers, defenders);
+
+    auto kills = find_kills(cfg, current_tick, entities, attackers, defenders);
+    apply_kills(kills);
+    if (!kills.empty())
+        activity->refresh();
+
+    // Bodies that moved into a sleeping region, or whose region fell asleep, skip from
+    // the next tick on; the rest of the sleeping ones are not touched at all.
+    for (std::uint32_t i : moving)
+        if (entities[i].alive && !activity->is_awake(i))
+            fall_asleep(entities[i], current_tick + 1);
+
+    ++current_tick;
+}
+
+void World::track_activity() {
+    activity->rebuild(entities);
+    for (std::size_t i = 0; i < entities.size(); ++i)
+        if (entities[i].alive && !activity->is_awake(i))
+            fall_asleep(entities[i], current_tick);
+}
+
+void World::apply_kills(const std::vector<Kill>& kills) {
+    for (const auto& kill : kills) {
+        entities[kill.defender].alive = false;
+        if (activity)
+            activity->relocate(kill.defender, entities[kill.defender]);
+        for (auto& o : observers)
+            o->on_kill(current_tick, entities[kill.attacker], entities[kill.defender]);
+    }
+}
+
+bool World::settled() const {
+    auto alive = alive_by_type();
+    for (NpcType a : NpcRegistry::types)
+        for (NpcType d : NpcRegistry::types)
+            if (alive[a] > 0 && alive[d] > 0 && NpcRegistry::eats[a][d])
+                return false;
+    return true;
+}
+
+int World::tick() const {
+    return current_tick;
+}
+
+const WorldConfig& World::config() const {
+    return cfg;
+}
+
+const std::vector<Body>& World::bodies() const {
+    return entities;
+}
+
+NpcRegistry::Table<int> World::alive_by_type() const {
+    NpcRegistry::Table<int> result{};
+    for (const auto& body : entities)
+        if (body.alive)
+            ++result[body.type];
+    return result;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "npc.h"
+#include "registry.h"
+#include "rng.h"
+
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <memory>
+#include <span>
+#include <string>
+
+// Everything the tick loops touch, packed into 16 bytes. Names are derived from
+// type and id on demand and observers are held once per World.
+struct Body {
+    std::uint32_t id{0};
+    std::int32_t x{0};
+    std::int32_t y{0};
+    NpcType type : 8 {Unknown};
+    bool alive{true};
+    // Set while the body sleeps in a quiet region, see doze_body.
+    std::uint16_t asleep_since{0};
+};
+
+static_assert(sizeof(Body) == 16);
+
+std::string body_name(const Body& body);
+
+struct WorldConfig {
+    int map_x{50};
+    int map_y{50};
+    std::uint64_t seed{0};
+};
+
+struct IKillObserver {
+    virtual void on_kill(int tick, const Body& attacker, const Body& defender) = 0;
+};
+
+// Movement rule shared by World and the shard workers.
+void move_body(Body& body, const WorldConfig& config, int tick);
+
+// mix holds relative spawn weights indexed by NpcType.
+using PopulationMix = NpcRegistry::Table<int>;
+
+// One of every registered type.
+inline constexpr PopulationMix EvenMix = [] {
+    PopulationMix mix{};
+    for (NpcType type : NpcRegistry::types)
+        mix[type] = 1;
+    return mix;
+}();
+
+// Throws std::runtime_error unless every weight is non-negative and some are positive.
+void check_mix(const PopulationMix& mix);
+
+std::vector<Body> random_population(const WorldConfig& config, int count, const PopulationMix& mix = EvenMix);
+
+class RegionActivity;
+struct Kill;
+struct SleepConfig;
+
+class World {
+private:
+    WorldConfig cfg;
+    int current_tick{0};
+    std::vector<Body> entities;
+    std::vector<std::shared_ptr<IKillObserver>> observers;
+    std::shared_ptr<RegionActivity> activity;
+
+    std::vector<std::uint32_t> moving;
+    std::vector<std::uint32_t> dozing;
+    std::vector<std::uint32_t> attackers;
+    std::vector<std::uint32_t> defenders;
+
+    void track_activity();
+    void apply_kills(const std::vector<Kill>& kills);
+
+public:
+    explicit World(const WorldConfig& config);
+
+    void reserve(std::size_t count);
+    std::uint32_t spawn(NpcType type, int x, int y);
+    void add(const Body& body);
+    // Grows the storage by `count` default bodies for the caller to fill in place.
+    std::span<Body> extend(std::size_t count);
+    void subscribe(std::shared_ptr<IKillObserver> observer);
+    void restore(int tick, std::vector<Body> bodies);
+    // Lets quiet regions sleep, see RegionActivity; a region size of 0 turns it off.
+    void enable_sleeping(const SleepConfig& sleep);
+    std::size_t sleeping_regions() const;
+
+    void step();
+    bool settled() const;
+
+    int tick() const;
+    const WorldConfig& config() const;
+    const std::vector<Body>& bodies() const;
+    NpcRegistry::Table<int> alive_by_type() const;
+};
@@ -0,0 +1,69 @@
+/*
+    Запросы к бинарному логу боёв (HW7_VAR6 --fight-log fights.bin).
+    Читаются только блоки, диапазоны которых в индексе могут содержать ответ.
+
+    HW7_VAR6_fightlog fights.bin [--attacker Knight_17] [--ticks 100 200] [--bbox 0 0 10 10] [--count]
+*/
+
+#include "fight_log.h"
+
+#include <string_view>
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Использование: " << argv[0]
+                  << " <лог> [--attacker Knight_17] [--ticks от до] [--bbox x0 y0 x1 y1] [--count]" << "\n";
+        return 1;
+    }
+
+    try {
+        FightQuery query;
+        bool count_only = false;
+
+        for (int i = 2; i < argc; ++i) {
+            std::string_view key = argv[i];
+
+            if (key == "--attacker" && i + 1 < argc) {
+                if (!parse_body_name(argv[++i], query)) {
+                    std::cerr << "Имя должно иметь вид Тип_номер: " << argv[i] << "\n";
+                    return 1;
+                }
+            } else if (key == "--ticks" && i + 2 < argc) {
+                query.tick_from = std::stoi(argv[++i]);
+                query.tick_to = std::stoi(argv[++i]);
+            } else if (key == "--bbox" && i + 4 < argc) {
+                std::array<std::int32_t, 4> box{};
+                for (auto& v : box)
+                    v = std::stoi(argv[++i]);
+                query.box = box;
+            } else if (key == "--count") {
+                count_only = true;
+            }
+        }
+
+        FightLogReader reader(argv[1]);
+
+        std::uint64_t found = 0;
+        std::size_t read = reader.query(query, [&](const FightRecord& r) {
+            ++found;
+            if (count_only)
+                return;
+
+            Body attacker, defender;
+            attacker.id = r.attacker_id;
+            attacker.type = r.attacker_type;
+            defender.id = r.defender_id;
+            defender.type = r.defender_type;
+
+            std::cout << "Тик " << r.tick << ": " << body_name(attacker) << " { x:" << r.attacker_x << ", y:" << r.attacker_y << "} "
+                      << "убил " << body_name(defender) << " { x:" << r.defender_x << ", y:" << r.defender_y << "}" << "\n";
+        });
+
+        std::cout << "Найдено: " << found << ", прочитано блоков: " << read << "/" << reader.blocks().size() << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Ошибка: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
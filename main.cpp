@@ -7,22 +7,30 @@
         Рыцарь ест драконов
 */
 
-#include "princess.h"
-#include "dragon.h"
-#include "knight.h"
+#include "registry.h"
+#include "world.h"
+#include "shard.h"
+#include "ensemble.h"
+#include "frame_feed.h"
+#include "footprint.h"
+#include "checkpoint.h"
+#include "fight_log.h"
+#include "region_stats.h"
+#include "activity.h"
+#include "fight_manager.h"
+#include "render.h"
+#include "observers.h"
+#include "spawn.h"
 
 #include <thread>
-#include <mutex>
-#include <queue>
-#include <optional>
 #include <chrono>
-#include <atomic>
 #include <array>
+#include <string_view>
+#include <set>
+#include <stdexcept>
 
 using namespace std::chrono_literals;
 
-std::mutex print_mutex;
-
 constexpr int MAP_X = 50;
 constexpr int MAP_Y = 50;
 constexpr int GRID = 25;
@@ -30,62 +38,15 @@ constexpr int GRID = 25;
 const bool USE_TEXT_OBSERVER = false;
 const bool USE_FILE_OBSERVER = true;
 
-class TextObserver : public IFightObserver {
-private:
-    TextObserver() {}
-
-public:
-    static std::shared_ptr<IFightObserver> get() {
-        static TextObserver instance;
-        return std::shared_ptr<IFightObserver>(&instance, [](IFightObserver*) {});
-    }
-
-    void on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win) override {
-        if (win) {
-            std::lock_guard<std::mutex> lck(print_mutex);
-            std::cout << "\n" << "Убийца --------" << "\n";
-            attacker->print(std::cout);
-            defender->print(std::cout);
-        }
-    }
-};
-
-class FileObserver : public IFightObserver {
-private:
-    std::ofstream fs;
-    FileObserver() { fs.open("log.txt"); }
+// Карта рисуется в отдельном процессе HW7_VAR6_viewer, а не под print_mutex.
+const bool USE_FRAME_FEED = true;
+const std::string FRAME_FEED = "/hw7_frames";
 
-public:
-    ~FileObserver() { fs.close(); }
-    static std::shared_ptr<IFightObserver> get() {
-        static FileObserver instance;
-        return std::shared_ptr<IFightObserver>(&instance, [](IFightObserver*) {});
-    }
-
-    void on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win) override {
-        if (win) {
-            fs << "\n" << "Убийца --------" << "\n";
-            attacker->print(fs);
-            defender->print(fs);
-        }
-    }
-};
+const ShutdownMode SHUTDOWN_MODE = ShutdownMode::Drain;
+constexpr auto SHUTDOWN_DEADLINE = 500ms;
 
 std::shared_ptr<NPC> factory(NpcType type, const std::string& name, int x, int y) {
-    std::shared_ptr<NPC> result;
-    switch (type) {
-    case PrincessType:
-        result = std::make_shared<Princess>(name, x, y);
-        break;
-    case DragonType:
-        result = std::make_shared<Dragon>(name, x, y);
-        break;
-    case KnightType:
-        result = std::make_shared<Knight>(name, x, y);
-        break;
-    default:
-        break;
-    }
+    std::shared_ptr<NPC> result = NpcRegistry::make(type, name, x, y);
 
     if (result) {
         if constexpr (USE_TEXT_OBSERVER)
@@ -97,178 +58,316 @@ std::shared_ptr<NPC> factory(NpcType type, const std::string& name, int x, int y
     return result;
 }
 
-struct FightEvent {
-    std::shared_ptr<NPC> attacker;
-    std::shared_ptr<NPC> defender;
+struct HeadlessOptions {
+    ShardLayout layout;
+    WorldConfig config;
+    PopulationMix mix{EvenMix};
+    int npcs{50};
+    int ticks{300};
+    int ensemble{0};
+    unsigned threads{0};
+    std::string feed;
+    int tick_ms{0};
+    int memory_report{0};
+    std::string checkpoint;
+    int checkpoint_every{100};
+    std::string resume;
+    std::string fight_log;
+    std::string stats;
+    int grid{GRID};
+    SleepConfig sleep;
+    std::string spawn;
+    SpawnPlan plan;
 };
 
-class FightManager {
-private:
-    std::queue<FightEvent> events;
-    std::mutex mtx;
-    FightManager() {}
-
-public:
-    static FightManager& get() {
-        static FightManager instance;
-        return instance;
+HeadlessOptions parse_options(int argc, char** argv) {
+    HeadlessOptions options;
+    options.config.seed = static_cast<std::uint64_t>(time(nullptr));
+
+    // Options the sharded run has no support for.
+    const std::set<std::string_view> single_process = {
+        "--feed", "--tick-ms", "--checkpoint", "--checkpoint-every", "--resume", "--fight-log", "--stats",
+        "--grid", "--sleep-region", "--sleep-stride", "--spawn", "--clusters", "--spread", "--points"};
+    std::string_view unsharded;
+
+    for (int i = 1; i < argc; i += 2) {
+        std::string_view key = argv[i];
+        if (i + 1 == argc)
+            throw std::runtime_error("нет значения для " + std::string(key));
+        std::string value = argv[i + 1];
+        if (single_process.contains(key))
+            unsharded = key;
+
+        if (key == "--shards") {
+            auto sep = value.find('x');
+            options.layout.shards_x = std::stoi(value.substr(0, sep));
+            options.layout.shards_y = sep == std::string::npos ? 1 : std::stoi(value.substr(sep + 1));
+        } else if (key == "--ticks") {
+            options.ticks = std::stoi(value);
+        } else if (key == "--seed") {
+            options.config.seed = std::stoull(value);
+        } else if (key == "--npcs") {
+            options.npcs = std::stoi(value);
+        } else if (key == "--ensemble") {
+            options.ensemble = std::stoi(value);
+        } else if (key == "--threads") {
+            options.threads = std::stoul(value);
+        } else if (key == "--mix") {
+            // One weight per registered type, in registry order; missing ones are 0.
+            options.mix.fill(0);
+            std::size_t from = 0;
+            for (NpcType type : NpcRegistry::types) {
+                if (from > value.size())
+                    break;
+                auto sep = std::min(value.find(':', from), value.size());
+                options.mix[type] = std::stoi(value.substr(from, sep - from));
+                from = sep + 1;
+            }
+            check_mix(options.mix);
+        } else if (key == "--feed") {
+            options.feed = value;
+        } else if (key == "--tick-ms") {
+            options.tick_ms = std::stoi(value);
+        } else if (key == "--memory-report") {
+            options.memory_report = std::stoi(value);
+        } else if (key == "--checkpoint") {
+            options.checkpoint = value;
+        } else if (key == "--checkpoint-every") {
+            options.checkpoint_every = std::stoi(value);
+        } else if (key == "--resume") {
+            options.resume = value;
+        } else if (key == "--fight-log") {
+            options.fight_log = value;
+        } else if (key == "--stats") {
+            options.stats = value;
+        } else if (key == "--grid") {
+            options.grid = std::stoi(value);
+        } else if (key == "--sleep-region") {
+            options.sleep.region = std::stoi(value);
+        } else if (key == "--sleep-stride") {
+            options.sleep.stride = std::stoi(value);
+        } else if (key == "--spawn") {
+            options.spawn = value;
+            options.plan.placement = placement_from_name(value);
+        } else if (key == "--clusters") {
+            options.plan.clusters = std::stoi(value);
+        } else if (key == "--spread") {
+            options.plan.spread = std::stod(value);
+        } else if (key == "--points") {
+            options.plan.file = value;
+        } else if (key == "--map") {
+            auto sep = value.find('x');
+            options.config.map_x = std::stoi(value.substr(0, sep));
+            options.config.map_y = sep == std::string::npos ? options.config.map_x : std::stoi(value.substr(sep + 1));
+        } else {
+            throw std::runtime_error("неизвестный параметр " + std::string(key));
+        }
     }
 
-    void add_event(FightEvent&& event) {
-        std::lock_guard<std::mutex> lck(mtx);
-        events.push(event);
-    }
+    if (options.layout.count() > 1 && !unsharded.empty())
+        throw std::runtime_error(std::string(unsharded) + " не работает вместе с --shards");
 
-    void operator()() {
-        while (true) {
-            std::optional<FightEvent> event;
-            
-            {
-                std::lock_guard<std::mutex> lck(mtx);
-                if (!events.empty()) {
-                    event = events.front();
-                    events.pop();
-                }
-            }
+    return options;
+}
 
-            if (event)
-                if (event->attacker->is_alive() && event->defender->is_alive())
-                    if (event->defender->accept(event->attacker))
-                        event->defender->must_die();
+void print_summary(const std::vector<Body>& bodies) {
+    NpcRegistry::Table<int> alive{};
+    for (const auto& body : bodies)
+        if (body.alive)
+            ++alive[body.type];
 
-            std::this_thread::sleep_for(100ms);
-        }
+    int total = 0;
+    for (NpcType type : NpcRegistry::types) {
+        std::cout << NpcRegistry::color[type] << NpcRegistry::title[type] << ": " << alive[type] << "\033[0m | ";
+        total += alive[type];
     }
-};
+    std::cout << "Всего: " << total << "/" << bodies.size() << "\n";
+}
 
-void draw_map(const std::vector<std::shared_ptr<NPC>>& npcs) {
-    std::array<std::pair<std::string, char>, GRID * GRID> field{};
+int run_ensemble_mode(const HeadlessOptions& options) {
+    EnsembleConfig config;
+    config.world = options.config;
+    config.mix = options.mix;
+    config.runs = options.ensemble;
+    config.npcs = options.npcs;
+    config.ticks = options.ticks;
+    config.threads = options.threads;
 
-    for (auto& cell : field)
-        cell = {"", ' '};
+    auto start = std::chrono::steady_clock::now();
+    EnsembleResult result = run_ensemble(config);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
 
-    for (const auto& npc : npcs) {
-        if (!npc->is_alive())
+    std::cout << "Миров: " << result.runs << " за " << elapsed.count() << " с ("
+              << static_cast<long>(result.runs / std::max(elapsed.count(), 1e-9) * 60) << " в минуту)\n";
+
+    for (NpcType type : NpcRegistry::types) {
+        if (options.mix[type] == 0)
             continue;
-        
-        auto [x, y] = npc->position();
-        int gx = std::min(x * GRID / MAP_X, GRID - 1);
-        int gy = std::min(y * GRID / MAP_Y, GRID - 1);
-
-        char c = '?';
-        switch (npc->type) {
-            case PrincessType: c = 'P'; break;
-            case DragonType: c = 'D'; break;
-            case KnightType: c = 'K'; break;
-            default: break;
-        }
+        std::cout << NpcRegistry::title[type] << ": выживаемость " << result.survival_rate(type) * 100 << "%, "
+                  << "вымирание в " << result.extinction_rate(type) * 100 << "% миров\n";
+        std::cout << "  выживших:";
+        for (std::size_t k = 0; k < result.survivors[type].size(); ++k)
+            if (result.survivors[type][k])
+                std::cout << " " << k << ":" << result.survivors[type][k];
+        std::cout << "\n";
+    }
 
-        field[gx + gy * GRID] = {npc->get_color(), c};
+    return 0;
+}
+
+// Детерминированный режим без вывода карты: --shards 2x2 --ticks 300 --seed 42 --npcs 50
+// Серия миров: --ensemble 100000 --mix 2:1:1 --threads 8
+// Кадры для HW7_VAR6_viewer: --feed /hw7_frames --tick-ms 100
+// Расход памяти на NPC в обоих представлениях: --memory-report 100000
+// Контрольные точки: --checkpoint run.ckpt --checkpoint-every 100, затем --resume run.ckpt
+// Бинарный лог боёв для HW7_VAR6_fightlog: --fight-log fights.bin
+// Статистика по клеткам в CSV на каждом тике: --stats cells.csv --grid 25
+// Усыпление тихих областей карты: --sleep-region 128 --sleep-stride 8
+// Параллельное расселение: --spawn uniform, --spawn clusters --clusters 16 --spread 0.05,
+// --spawn file --points points.txt (строки "x y")
+int run_headless(int argc, char** argv) {
+    HeadlessOptions options = parse_options(argc, argv);
+    if (options.memory_report > 0) {
+        print_memory_report(std::cout, options.memory_report);
+        return 0;
     }
+    if (options.ensemble > 0)
+        return run_ensemble_mode(options);
+
+    std::vector<Body> result;
+    if (options.layout.count() > 1) {
+        auto initial = random_population(options.config, options.npcs, options.mix);
+        result = run_sharded(options.config, options.layout, initial, options.ticks);
+    } else {
+        World world = options.resume.empty() ? World(options.config) : load_checkpoint(options.resume);
+        if (!options.resume.empty()) {
+            std::cout << "Продолжение с тика " << world.tick() << "\n";
+        } else if (!options.spawn.empty()) {
+            SpawnPlan plan = options.plan;
+            plan.counts = split_counts(options.npcs, options.mix);
+            plan.threads = options.threads;
+
+            auto start = std::chrono::steady_clock::now();
+            bulk_spawn(world, plan);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "Расселено " << world.bodies().size() << " NPC за " << elapsed.count() << " с\n";
+        } else {
+            for (const auto& body : random_population(options.config, options.npcs, options.mix))
+                world.add(body);
+        }
 
-    std::lock_guard<std::mutex> lck(print_mutex);
-    std::cout << "\n";
+        world.enable_sleeping(options.sleep);
 
-    for (int y = 0; y < GRID; ++y) {
-        for (int x = 0; x < GRID; ++x) {
-            auto [color, c] = field[x + y * GRID];
+        if (!options.fight_log.empty())
+            world.subscribe(std::make_shared<FightLogWriter>(options.fight_log));
 
-            if (c != ' ')
-                std::cout << "|" << color << c << "\033[0m|";
-            else 
-                std::cout << "| |";
+        std::shared_ptr<RegionStats> stats;
+        std::ofstream stats_file;
+        if (!options.stats.empty()) {
+            stats = std::make_shared<RegionStats>(world.config(), options.grid, options.grid, options.threads);
+            world.subscribe(stats);
+            stats_file.open(options.stats);
+            RegionStats::export_csv_header(stats_file);
         }
-        std::cout << "\n";
-    }
-    std::cout << std::string(GRID * 3, '=') << "\n";
 
-    int alive_princesses = 0, alive_dragons = 0, alive_knights = 0;
-    for (const auto& npc : npcs) {
-        if (!npc->is_alive()) continue;
-        switch (npc->type) {
-            case PrincessType: alive_princesses++; break;
-            case DragonType:   alive_dragons++; break;
-            case KnightType:   alive_knights++; break;
-            default: break;
+        std::unique_ptr<FramePublisher> feed;
+        if (!options.feed.empty())
+            feed = std::make_unique<FramePublisher>(options.feed, static_cast<std::uint32_t>(world.bodies().size()));
+
+        std::unique_ptr<CheckpointWriter> checkpoint;
+        if (!options.checkpoint.empty()) {
+            checkpoint = std::make_unique<CheckpointWriter>(options.checkpoint, options.checkpoint_every);
+            checkpoint->record(world);
         }
+
+        while (world.tick() < options.ticks) {
+            world.step();
+            if (feed)
+                feed->publish(world.tick(), world.config(), world.bodies());
+            if (checkpoint)
+                checkpoint->record(world);
+            if (stats) {
+                stats->update(world.bodies());
+                stats->export_csv(stats_file, world.tick());
+                stats->clear_kills();
+            }
+            if (options.tick_ms > 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.tick_ms));
+        }
+        result = world.bodies();
+        options.config = world.config();
     }
 
-    std::cout << "\033[35mПринцессы: " << alive_princesses << "\033[0m | "
-              << "\033[31mДраконы: " << alive_dragons << "\033[0m | "
-              << "\033[34mРыцари: " << alive_knights << "\033[0m | "
-              << "Всего: " << (alive_princesses + alive_dragons + alive_knights) << "/50\n";
+    std::cout << "Сид: " << options.config.seed << ", шардов: " << options.layout.count()
+              << ", тиков: " << options.ticks << "\n";
+    print_summary(result);
+
+    return 0;
 }
 
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        try {
+            return run_headless(argc, argv);
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка: " << e.what() << "\n";
+            return 1;
+        }
+    }
 
-int main() {
     std::srand(static_cast<unsigned>(time(nullptr)));
 
     std::vector<std::shared_ptr<NPC>> npcs;
 
     std::cout << "Создание 50 NPC..." << "\n";
     for (int i = 0; i < 50; ++i) {
-        NpcType type = static_cast<NpcType>(std::rand() % 3 + 1);
-        std::string name;
-        switch (type) {
-            case PrincessType: name = "Princess_"; break;
-            case DragonType: name = "Dragon_"; break;
-            case KnightType: name = "Knight_"; break;
-            case Unknown: name = "Unknown_"; break;
-        }
-        name += std::to_string(i);
+        NpcType type = NpcRegistry::types[std::rand() % NpcRegistry::types.size()];
+        std::string name = type_name(type) + "_" + std::to_string(i);
         
         npcs.push_back(factory(type, name, std::rand() % MAP_X, std::rand() % MAP_Y));
     }
 
-    std::atomic<bool> running{true};
+    WorldConfig config;
+    config.map_x = MAP_X;
+    config.map_y = MAP_Y;
 
-    std::thread fight_thread(std::ref(FightManager::get()));
-
-    std::thread move_thread([&npcs, &running]() {
-        while (running) {
-            for (auto& npc : npcs) {
-                if (!npc->is_alive())
-                    continue;
-
-                int move_dist = npc->get_move_distance();
-                int shift_x = std::rand() % (2 * move_dist + 1) - move_dist;
-                int shift_y = std::rand() % (2 * move_dist + 1) - move_dist;
-                
-                npc->move(shift_x, shift_y, MAP_X, MAP_Y);
-            }
+    std::unique_ptr<FramePublisher> feed;
+    if constexpr (USE_FRAME_FEED) {
+        feed = std::make_unique<FramePublisher>(FRAME_FEED, static_cast<std::uint32_t>(npcs.size()));
+        std::cout << "Карта: HW7_VAR6_viewer " << FRAME_FEED << "\n";
+    }
 
-            for (auto& attacker : npcs) {
-                if (!attacker->is_alive())
-                    continue;
-                
-                int kill_dist = attacker->get_kill_distance();
-                
-                for (auto& defender : npcs) {
-                    if (attacker == defender || !defender->is_alive())
-                        continue;
-                    
-                    if (attacker->is_close(defender, kill_dist))
-                        FightManager::get().add_event({attacker, defender});
-                }
-            }
+    FightManager::get().start();
 
-            std::this_thread::sleep_for(100ms);
-        }
+    std::jthread move_thread([&npcs, &feed, &config](std::stop_token stop) {
+        int tick = 0;
+        do {
+            move_npcs(npcs, MAP_X, MAP_Y);
+            queue_fights(npcs, FightManager::get());
+            if (feed)
+                feed->publish(tick++, config, snapshot_bodies(npcs));
+        } while (wait_for_stop(stop, 100ms));
     });
 
-    std::thread print_thread([&npcs, &running]() {
-        while (running) {
-            draw_map(npcs);
-            std::this_thread::sleep_for(1s);
-        }
+    std::jthread print_thread([&npcs, &config](std::stop_token stop) {
+        if constexpr (USE_FRAME_FEED)
+            return;
+
+        do {
+            draw_map(npcs, config, GRID);
+        } while (wait_for_stop(stop, 1s));
     });
 
     std::this_thread::sleep_for(30s);
-    running = false;
 
+    move_thread.request_stop();
+    print_thread.request_stop();
     move_thread.join();
     print_thread.join();
-    fight_thread.detach();
+
+    ShutdownReport report = FightManager::get().stop(SHUTDOWN_MODE, SHUTDOWN_DEADLINE);
+    std::cout << "\nБоёв проведено: " << report.resolved << ", отброшено: " << report.dropped
+              << (report.in_time ? "" : " (остановка не уложилась в срок)") << "\n";
 
     std::cout << "\n=== ВЫЖИВШИЕ ===\n";
     int survivors = 0;
@@ -9,11 +9,5 @@ struct Knight : public NPC {
     void print(std::ostream& os) override;
     void save(std::ostream& os) override;
 
-    bool visit(std::shared_ptr<Princess> other) override;
-    bool visit(std::shared_ptr<Dragon> other) override;
-    bool visit(std::shared_ptr<Knight> other) override;
-
-    bool accept(std::shared_ptr<NPC> attacker) override;
-
     friend std::ostream& operator<<(std::ostream& os, Knight& knight);
 };
@@ -1,4 +1,5 @@
 #include "npc.h"
+#include "registry.h"
 
 using lm = std::lock_guard<std::mutex>;
 
@@ -17,11 +18,32 @@ void NPC::fight_notify(const std::shared_ptr<NPC> defender, bool win) {
 }
 
 bool NPC::is_close(const std::shared_ptr<NPC>& other, size_t distance) const {
-    int dx = x - other->x;
-    int dy = y - other->y;
+    auto [ax, ay] = position();
+    auto [bx, by] = other->position();
+    int dx = ax - bx;
+    int dy = ay - by;
     return dx * dx + dy * dy <= (int)(distance * distance);
 }
 
+bool NPC::attack(std::shared_ptr<NPC> defender) {
+    if (!can_eat(type, defender->type))
+        return false;
+
+    int defense = std::rand() % 6 + 1;
+    int attack = std::rand() % 6 + 1;
+
+    if (attack > defense) {
+        fight_notify(defender, true);
+        return true;
+    }
+
+    return false;
+}
+
+bool NPC::accept(std::shared_ptr<NPC> attacker) {
+    return attacker->attack(shared_from_this());
+}
+
 void NPC::save(std::ostream& os) {
     os << name << std::endl << x << std::endl << y << std::endl;
 }
@@ -51,34 +73,44 @@ std::pair<int, int> NPC::position() const {
     return {x, y};
 }
 
+int move_distance(NpcType type) {
+    return NpcRegistry::speed[type];
+}
+
+int kill_distance(NpcType type) {
+    return NpcRegistry::reach[type];
+}
+
+bool can_eat(NpcType attacker, NpcType defender) {
+    return NpcRegistry::eats[attacker][defender];
+}
+
 int NPC::get_move_distance() const {
-    switch (type) {
-        case PrincessType: return 1;
-        case DragonType: return 50;
-        case KnightType: return 30;
-        default: return 0;
-    }
+    return move_distance(type);
 }
 
 int NPC::get_kill_distance() const {
-    switch (type) {
-        case PrincessType: return 1;
-        case DragonType: return 30;
-        case KnightType: return 10;
-        default: return 0;
-    }
+    return kill_distance(type);
+}
+
+std::string color_code(NpcType type) {
+    return std::string(NpcRegistry::color[type]);
+}
+
+char symbol(NpcType type) {
+    return NpcRegistry::symbol[type];
+}
+
+std::string type_name(NpcType type) {
+    return std::string(NpcRegistry::name[type]);
 }
 
 std::string NPC::get_color() const {
-    switch (type) {
-        case PrincessType: return "\033[35m";
-        case DragonType: return "\033[31m";
-        case KnightType: return "\033[34m";
-        default: return "\033[0m";
-    }
+    return color_code(type);
 }
 
 std::ostream& operator<<(std::ostream& os, NPC& npc) {
-    os << "{ x:" << npc.x << ", y:" << npc.y << "} ";
+    auto [x, y] = npc.position();
+    os << "{ x:" << x << ", y:" << y << "} ";
     return os;
 }
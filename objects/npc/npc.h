@@ -25,6 +25,13 @@ enum NpcType {
     KnightType = 3
 };
 
+int move_distance(NpcType type);
+int kill_distance(NpcType type);
+bool can_eat(NpcType attacker, NpcType defender);
+std::string color_code(NpcType type);
+char symbol(NpcType type);
+std::string type_name(NpcType type);
+
 struct IFightObserver {
     virtual void on_fight(const std::shared_ptr<NPC> attacker, 
                           const std::shared_ptr<NPC> defender, bool win) = 0;
@@ -46,11 +53,9 @@ struct NPC : public std::enable_shared_from_this<NPC> {
     void fight_notify(const std::shared_ptr<NPC> defender, bool win);
     bool is_close(const std::shared_ptr<NPC>& other, size_t distance) const;
 
-    virtual bool visit(std::shared_ptr<Princess> other) = 0;
-    virtual bool visit(std::shared_ptr<Dragon> other) = 0;
-    virtual bool visit(std::shared_ptr<Knight> other) = 0;
-
-    virtual bool accept(std::shared_ptr<NPC> attacker) = 0;
+    // Rolls the dice if the registry lets this type eat the defender's type.
+    bool attack(std::shared_ptr<NPC> defender);
+    bool accept(std::shared_ptr<NPC> attacker);
 
     virtual void print(std::ostream& os) = 0;
     virtual void save(std::ostream& os);
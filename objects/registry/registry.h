@@ -0,0 +1,160 @@
+#pragma once
+
+#include "princess.h"
+#include "dragon.h"
+#include "knight.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <string_view>
+
+// Everything the engine knows about an NPC type. A new type is its NpcType value,
+// its class, one NpcTraits specialisation and an entry in NpcRegistry below.
+template <class Object>
+struct NpcTraits;
+
+template <>
+struct NpcTraits<Princess> {
+    static constexpr NpcType type = PrincessType;
+    static constexpr int speed = 1;
+    static constexpr int reach = 1;
+    static constexpr char symbol = 'P';
+    static constexpr std::string_view color = "\033[35m";
+    static constexpr std::string_view name = "Princess";
+    static constexpr std::string_view title = "Принцессы";
+    static constexpr std::string_view column = "princesses";
+    static constexpr std::array<NpcType, 0> prey{};
+};
+
+template <>
+struct NpcTraits<Dragon> {
+    static constexpr NpcType type = DragonType;
+    static constexpr int speed = 50;
+    static constexpr int reach = 30;
+    static constexpr char symbol = 'D';
+    static constexpr std::string_view color = "\033[31m";
+    static constexpr std::string_view name = "Dragon";
+    static constexpr std::string_view title = "Драконы";
+    static constexpr std::string_view column = "dragons";
+    static constexpr std::array<NpcType, 1> prey{PrincessType};
+};
+
+template <>
+struct NpcTraits<Knight> {
+    static constexpr NpcType type = KnightType;
+    static constexpr int speed = 30;
+    static constexpr int reach = 10;
+    static constexpr char symbol = 'K';
+    static constexpr std::string_view color = "\033[34m";
+    static constexpr std::string_view name = "Knight";
+    static constexpr std::string_view title = "Рыцари";
+    static constexpr std::string_view column = "knights";
+    static constexpr std::array<NpcType, 1> prey{DragonType};
+};
+
+// Tables indexed by NpcType, built at compile time from the traits. Slots without a
+// type (Unknown) keep the neutral values the old per-type switches returned.
+template <class... Objects>
+struct TypeRegistry {
+    static constexpr std::size_t size = std::max({static_cast<std::size_t>(NpcTraits<Objects>::type)...}) + 1;
+
+    template <class T>
+    using Table = std::array<T, size>;
+
+    // Every registered type, in registration order.
+    static constexpr std::array<NpcType, sizeof...(Objects)> types{NpcTraits<Objects>::type...};
+
+    static constexpr Table<int> speed = [] {
+        Table<int> result{};
+        ((result[NpcTraits<Objects>::type] = NpcTraits<Objects>::speed), ...);
+        return result;
+    }();
+
+    static constexpr Table<int> reach = [] {
+        Table<int> result{};
+        ((result[NpcTraits<Objects>::type] = NpcTraits<Objects>::reach), ...);
+        return result;
+    }();
+
+    static constexpr Table<char> symbol = [] {
+        Table<char> result{};
+        result.fill('?');
+        ((result[NpcTraits<Objects>::type] = NpcTraits<Objects>::symbol), ...);
+        return result;
+    }();
+
+    static constexpr Table<std::string_view> color = [] {
+        Table<std::string_view> result{};
+        result.fill("\033[0m");
+        ((result[NpcTraits<Objects>::type] = NpcTraits<Objects>::color), ...);
+        return result;
+    }();
+
+    static constexpr Table<std::string_view> name = [] {
+        Table<std::string_view> result{};
+        result.fill("Unknown");
+        ((result[NpcTraits<Objects>::type] = NpcTraits<Objects>::name), ...);
+        return result;
+    }();
+
+    // Plural names: title for the summaries, column for the CSV header.
+    static constexpr Table<std::string_view> title = [] {
+        Table<std::string_view> result{};
+        result.fill("Неизвестные");
+        ((result[NpcTraits<Objects>::type] = NpcTraits<Objects>::title), ...);
+        return result;
+    }();
+
+    static constexpr Table<std::string_view> column = [] {
+        Table<std::string_view> result{};
+        result.fill("unknown");
+        ((result[NpcTraits<Objects>::type] = NpcTraits<Objects>::column), ...);
+        return result;
+    }();
+
+    // eats[attacker][defender]
+    static constexpr Table<Table<bool>> eats = [] {
+        Table<Table<bool>> result{};
+        auto mark = [&result](NpcType attacker, const auto& prey) {
+            for (NpcType defender : prey)
+                result[attacker][defender] = true;
+        };
+        (mark(NpcTraits<Objects>::type, NpcTraits<Objects>::prey), ...);
+        return result;
+    }();
+
+    static constexpr Table<bool> predator = [] {
+        Table<bool> result{};
+        for (std::size_t a = 0; a < size; ++a)
+            for (std::size_t d = 0; d < size; ++d)
+                result[a] = result[a] || eats[a][d];
+        return result;
+    }();
+
+    static constexpr Table<bool> prey = [] {
+        Table<bool> result{};
+        for (std::size_t a = 0; a < size; ++a)
+            for (std::size_t d = 0; d < size; ++d)
+                result[d] = result[d] || eats[a][d];
+        return result;
+    }();
+
+    static constexpr int max_speed = std::max({NpcTraits<Objects>::speed...});
+    static constexpr int max_reach = std::max({NpcTraits<Objects>::reach...});
+
+    // Calls fn.template operator()<Object>() for the class of `type`, so the body is
+    // compiled once per type with its traits as constants.
+    template <class Fn>
+    static void dispatch(NpcType type, Fn&& fn) {
+        ((type == NpcTraits<Objects>::type ? (fn.template operator()<Objects>(), true) : false) || ...);
+    }
+
+    static std::shared_ptr<NPC> make(NpcType type, const std::string& name, int x, int y) {
+        std::shared_ptr<NPC> result;
+        dispatch(type, [&]<class Object>() { result = std::make_shared<Object>(name, x, y); });
+        return result;
+    }
+};
+
+using NpcRegistry = TypeRegistry<Princess, Dragon, Knight>;
@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include "princess.h"
+#include "dragon.h"
+#include "knight.h"
+#include "world.h"
+#include "activity.h"
+#include "fight_manager.h"
+#include "registry.h"
+
+using namespace std::chrono_literals;
+
+// Нагрузочные тесты движка: ctest -L stress.
+// Пороги тиков в секунду и сроки заданы для сборки с оптимизацией; HW7_STRESS_SLOWDOWN
+// делит пороги и умножает сроки, например для ThreadSanitizer (-DHW7_TSAN=ON).
+// Без NDEBUG по умолчанию множитель 10, 0 отключает проверки.
+
+namespace {
+
+double slowdown() {
+#ifdef NDEBUG
+    double factor = 1.0;
+#else
+    double factor = 10.0;
+#endif
+    if (const char* value = std::getenv("HW7_STRESS_SLOWDOWN"))
+        factor = std::atof(value);
+    return factor;
+}
+
+double min_ticks_per_sec(double baseline) {
+    return slowdown() > 0 ? baseline / slowdown() : 0.0;
+}
+
+std::chrono::milliseconds max_latency(std::chrono::milliseconds baseline) {
+    if (slowdown() <= 0)
+        return std::chrono::hours(1);
+    return std::chrono::milliseconds(static_cast<long>(baseline.count() * slowdown()));
+}
+
+std::vector<std::shared_ptr<NPC>> make_npcs(int count, int map_x, int map_y) {
+    std::vector<std::shared_ptr<NPC>> npcs;
+    npcs.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        std::string name = std::to_string(i);
+        int x = i * 7919 % (map_x + 1);
+        int y = i * 104729 % (map_y + 1);
+        npcs.push_back(NpcRegistry::make(NpcRegistry::types[i % NpcRegistry::types.size()], name, x, y));
+    }
+    return npcs;
+}
+
+}
+
+TEST(Stress, ProducersAndConsumersLoseNoEvents) {
+    constexpr int producers = 8;
+    constexpr int consumers = 4;
+    constexpr int per_producer = 20000;
+
+    auto npcs = make_npcs(1000, 500, 500);
+    FightManager manager;
+
+    std::atomic<int> producing{producers};
+    std::atomic<std::size_t> drained{0};
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < per_producer; ++i) {
+                std::size_t a = (p * per_producer + i) % npcs.size();
+                std::size_t d = (a * 31 + 17) % npcs.size();
+                manager.add_event({npcs[a], npcs[d]});
+            }
+            --producing;
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&]() {
+            while (producing > 0 || manager.pending() > 0)
+                drained += manager.drain();
+        });
+    }
+    std::thread mover([&]() {
+        while (producing > 0)
+            move_npcs(npcs, 500, 500);
+    });
+
+    for (auto& t : threads)
+        t.join();
+    mover.join();
+
+    EXPECT_EQ(drained.load(), static_cast<std::size_t>(producers * per_producer));
+    EXPECT_EQ(manager.pending(), 0u);
+}
+
+TEST(Stress, ShutdownUnderLoadMeetsDeadline) {
+    constexpr int producers = 4;
+    constexpr int per_producer = 50000;
+
+    auto npcs = make_npcs(1000, 50, 50);
+    FightManager manager;
+    manager.start();
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < per_producer; ++i) {
+                std::size_t a = (p * per_producer + i) % npcs.size();
+                manager.add_event({npcs[a], npcs[(a + 1) % npcs.size()]});
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    ShutdownReport report = manager.stop(ShutdownMode::Discard, max_latency(50ms));
+    // The worker may have resolved part of the events before stop(), which the report leaves out.
+    EXPECT_TRUE(report.in_time);
+    EXPECT_LE(report.resolved + report.dropped, static_cast<std::size_t>(producers * per_producer));
+    EXPECT_EQ(manager.pending(), 0u);
+}
+
+TEST(Stress, InteractiveLoopKeepsUp) {
+    auto npcs = make_npcs(1000, 50, 50);
+    FightManager manager;
+
+    std::atomic<bool> running{true};
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < 2; ++c)
+        consumers.emplace_back([&]() {
+            while (running)
+                if (manager.drain() == 0)
+                    std::this_thread::sleep_for(1ms);
+        });
+
+    constexpr int ticks = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < ticks; ++t) {
+        move_npcs(npcs, 50, 50);
+        queue_fights(npcs, manager);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    running = false;
+    for (auto& t : consumers)
+        t.join();
+    manager.drain();
+
+    std::size_t alive = 0;
+    for (const auto& npc : npcs)
+        alive += npc->is_alive();
+    EXPECT_LT(alive, npcs.size());
+    EXPECT_EQ(manager.pending(), 0u);
+    double rate = ticks / elapsed.count();
+    std::cout << "Тиков в секунду: " << rate << "\n";
+    EXPECT_GE(rate, min_ticks_per_sec(20.0));
+}
+
+TEST(Stress, MillionBodiesTickRate) {
+    WorldConfig config;
+    config.seed = 11;
+    config.map_x = 20000;
+    config.map_y = 20000;
+
+    World world(config);
+    for (const auto& body : random_population(config, 1000000))
+        world.add(body);
+
+    constexpr int ticks = 10;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < ticks; ++t)
+        world.step();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    auto alive = world.alive_by_type();
+    EXPECT_LT(alive[PrincessType] + alive[DragonType] + alive[KnightType], 1000000);
+    double rate = ticks / elapsed.count();
+    std::cout << "Тиков в секунду: " << rate << "\n";
+    EXPECT_GE(rate, min_ticks_per_sec(1.5));
+}
+
+TEST(Stress, SparseWorldSleepsFaster) {
+    WorldConfig config;
+    config.seed = 12;
+    config.map_x = 20000;
+    config.map_y = 20000;
+
+    // Princesses all over the map, the predators crowded into one corner.
+    auto population = random_population(config, 1000000, {0, 100, 1, 1});
+    for (auto& body : population) {
+        if (body.type != PrincessType) {
+            body.x %= 2000;
+            body.y %= 2000;
+        }
+    }
+
+    auto measure = [&](const SleepConfig& sleep) {
+        World world(config);
+        for (const auto& body : population)
+            world.add(body);
+        world.enable_sleeping(sleep);
+        world.step();
+
+        constexpr int ticks = 10;
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < ticks; ++t)
+            world.step();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return ticks / elapsed.count();
+    };
+
+    double plain = measure({0, 8});
+    double sleepy = measure({200, 8});
+    std::cout << "Тиков в секунду: " << plain << " без сна, " << sleepy << " со сном\n";
+    EXPECT_GE(sleepy, min_ticks_per_sec(1.5 * plain));
+}
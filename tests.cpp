@@ -3,96 +3,34 @@
 #include <fstream>
 #include <thread>
 #include <mutex>
-#include <queue>
-#include <optional>
 #include <chrono>
 #include <atomic>
 #include <array>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "princess.h"
 #include "dragon.h"
 #include "knight.h"
+#include "world.h"
+#include "shard.h"
+#include "fight.h"
+#include "ensemble.h"
+#include "frame_feed.h"
+#include "footprint.h"
+#include "checkpoint.h"
+#include "fight_log.h"
+#include "region_stats.h"
+#include "activity.h"
+#include "fight_manager.h"
+#include "render.h"
+#include "spawn.h"
+#include "registry.h"
 
 using namespace std::chrono_literals;
-std::mutex print_mutex;
-
-constexpr int MAP_X = 50;
-constexpr int MAP_Y = 50;
-constexpr int GRID = 25;
-
-struct FightEvent {
-    std::shared_ptr<NPC> attacker;
-    std::shared_ptr<NPC> defender;
-};
-
-class FightManager {
-private:
-    std::queue<FightEvent> events;
-    std::mutex mtx;
-    FightManager() {}
-
-public:
-    static FightManager& get() {
-        static FightManager instance;
-        return instance;
-    }
-
-    void add_event(FightEvent&& event) {
-        std::lock_guard<std::mutex> lck(mtx);
-        events.push(event);
-    }
-
-    void operator()() {
-        std::lock_guard<std::mutex> lck(mtx);
-        while (!events.empty()) {
-            auto event = events.front();
-            events.pop();
-            if (event.attacker->is_alive() && event.defender->is_alive()) {
-                if (event.defender->accept(event.attacker)) {
-                    event.defender->must_die();
-                }
-            }
-        }
-    }
-};
-
-void draw_map(const std::vector<std::shared_ptr<NPC>>& npcs) {
-    std::array<std::pair<std::string, char>, GRID * GRID> field{};
-    int princesses = 0, dragons = 0, knights = 0;
-
-    for (auto& npc : npcs) {
-        if (!npc->is_alive()) continue;
-
-        auto [x, y] = npc->position();
-        int gx = std::min(x * GRID / MAP_X, GRID - 1);
-        int gy = std::min(y * GRID / MAP_Y, GRID - 1);
-        char symbol;
-        std::string color = npc->get_color();
-
-        switch (npc->type) {
-            case PrincessType: symbol = 'P'; ++princesses; break;
-            case DragonType: symbol = 'D'; ++dragons; break;
-            case KnightType: symbol = 'K'; ++knights; break;
-            default: continue;
-        }
-
-        field[gx + gy * GRID] = {color, symbol};
-    }
-
-    {
-        std::lock_guard<std::mutex> lck(print_mutex);
-        for (int y = 0; y < GRID; ++y) {
-            for (int x = 0; x < GRID; ++x) {
-                auto [color, c] = field[x + y * GRID];
-                if (c != ' ') std::cout << "|" << color << c << "\033[0m|";
-                else std::cout << "| |";
-            }
-            std::cout << "\n";
-        }
-        std::cout << std::string(GRID * 3, '=') << "\n";
-        std::cout << "Принцессы: " << princesses << " | Драконы: " << dragons << " | Рыцари: " << knights << " | Всего: " << princesses + dragons + knights << "/50\n";
-    }
-}
 
 TEST(NPCCreation, CreatePrincess) {
     Princess princess("TestPrincess", 100, 200);
@@ -259,7 +197,7 @@ TEST(Observer, NoNotifyOnFightLose) {
     knight->subscribe(mock);
     auto dragon = std::make_shared<Dragon>("Dragon", 0, 0);
     srand(0);
-    knight->visit(dragon);
+    knight->attack(dragon);
     EXPECT_FALSE(mock->called);
 }
 
@@ -276,6 +214,108 @@ TEST(MapDrawing, SimpleDrawWithOneNPC) {
     EXPECT_NE(output.find("Принцессы: 1"), std::string::npos);
 }
 
+TEST(FightManager, QueuesOnlyPairsInReach) {
+    std::vector<std::shared_ptr<NPC>> npcs{
+        std::make_shared<Princess>("Princess", 0, 0),
+        std::make_shared<Dragon>("Dragon", 5, 5),
+        std::make_shared<Knight>("Knight", 40, 40)};
+
+    FightManager manager;
+    queue_fights(npcs, manager);
+    EXPECT_EQ(manager.pending(), 1u);
+
+    EXPECT_EQ(manager.drain(), 1u);
+    EXPECT_EQ(manager.pending(), 0u);
+    EXPECT_EQ(manager.drain(), 0u);
+}
+
+TEST(FightManager, SkipsFightsOfTheDead) {
+    auto mock = std::make_shared<MockObserver>();
+    auto knight = std::make_shared<Knight>("Knight", 0, 0);
+    auto dragon = std::make_shared<Dragon>("Dragon", 0, 0);
+    knight->subscribe(mock);
+    dragon->must_die();
+
+    FightManager manager;
+    for (int i = 0; i < 10; ++i)
+        manager.add_event({knight, dragon});
+    EXPECT_EQ(manager.drain(), 10u);
+    EXPECT_FALSE(mock->called);
+}
+
+TEST(FightManager, StopDrainsOrDiscards) {
+    auto knight = std::make_shared<Knight>("Knight", 0, 0);
+    auto dragon = std::make_shared<Dragon>("Dragon", 0, 0);
+    dragon->must_die();
+
+    FightManager manager;
+    for (int i = 0; i < 100; ++i)
+        manager.add_event({knight, dragon});
+    ShutdownReport drained = manager.stop(ShutdownMode::Drain, 1s);
+    EXPECT_EQ(drained.resolved, 100u);
+    EXPECT_EQ(drained.dropped, 0u);
+    EXPECT_TRUE(drained.in_time);
+
+    manager.start();
+    manager.stop(ShutdownMode::Drain, 1s);
+    for (int i = 0; i < 100; ++i)
+        manager.add_event({knight, dragon});
+    ShutdownReport discarded = manager.stop(ShutdownMode::Discard, 1s);
+    EXPECT_EQ(discarded.resolved, 0u);
+    EXPECT_EQ(discarded.dropped, 100u);
+    EXPECT_EQ(manager.pending(), 0u);
+
+    std::size_t handed_over = 0;
+    for (const auto& queue : discarded.dropped_events)
+        handed_over += queue.size();
+    EXPECT_EQ(handed_over, 100u);
+}
+
+TEST(FightManager, WorkerWakesOnEventsAndStopsPromptly) {
+    auto knight = std::make_shared<Knight>("Knight", 0, 0);
+    auto dragon = std::make_shared<Dragon>("Dragon", 0, 0);
+    dragon->must_die();
+
+    FightManager manager;
+    manager.start();
+    manager.add_event({knight, dragon});
+    for (int i = 0; i < 1000 && manager.pending() > 0; ++i)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_EQ(manager.pending(), 0u);
+
+    auto start = std::chrono::steady_clock::now();
+    std::jthread waiter([&](std::stop_token stop) {
+        while (wait_for_stop(stop, 10s)) {}
+    });
+    waiter.request_stop();
+    waiter.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+
+    ShutdownReport report = manager.stop(ShutdownMode::Drain, 100ms);
+    EXPECT_EQ(report.resolved, 0u);
+    EXPECT_TRUE(report.in_time);
+}
+
+TEST(FightManager, StopReportsOnlyItsOwnEvents) {
+    auto knight = std::make_shared<Knight>("Knight", 0, 0);
+    auto dragon = std::make_shared<Dragon>("Dragon", 0, 0);
+    dragon->must_die();
+
+    FightManager manager;
+    for (int i = 0; i < 10; ++i)
+        manager.add_event({knight, dragon});
+    EXPECT_EQ(manager.drain(), 10u);
+
+    manager.add_event({knight, dragon});
+    ShutdownReport report = manager.stop(ShutdownMode::Drain, 1s);
+    EXPECT_EQ(report.resolved, 1u);
+    EXPECT_EQ(report.dropped, 0u);
+
+    report = manager.stop(ShutdownMode::Discard, 1s);
+    EXPECT_EQ(report.resolved, 0u);
+    EXPECT_EQ(report.dropped, 0u);
+}
+
 TEST(EdgeCases, EmptyName) {
     Princess princess("", 0, 0);
     EXPECT_EQ(princess.name, "");
@@ -326,6 +366,938 @@ TEST(Integration, SaveAndLoadFile) {
     std::remove(filename.c_str());
 }
 
+TEST(World, SameSeedSameResult) {
+    WorldConfig config;
+    config.seed = 42;
+
+    World a(config), b(config);
+    for (const auto& body : random_population(config, 50)) {
+        a.add(body);
+        b.add(body);
+    }
+    for (int t = 0; t < 100; ++t) {
+        a.step();
+        b.step();
+    }
+
+    ASSERT_EQ(a.bodies().size(), b.bodies().size());
+    for (std::size_t i = 0; i < a.bodies().size(); ++i) {
+        EXPECT_EQ(a.bodies()[i].x, b.bodies()[i].x);
+        EXPECT_EQ(a.bodies()[i].y, b.bodies()[i].y);
+        EXPECT_EQ(a.bodies()[i].alive, b.bodies()[i].alive);
+    }
+}
+
+TEST(World, OnlyPredatorsKill) {
+    WorldConfig config;
+    config.seed = 7;
+
+    World world(config);
+    for (int i = 0; i < 20; ++i)
+        world.spawn(PrincessType, 25, 25);
+    for (int t = 0; t < 50; ++t)
+        world.step();
+
+    EXPECT_EQ(world.alive_by_type()[PrincessType], 20);
+}
+
+TEST(Shard, LayoutCoversMap) {
+    WorldConfig config;
+    ShardLayout layout{3, 2};
+
+    for (int x = 0; x <= config.map_x; ++x) {
+        for (int y = 0; y <= config.map_y; ++y) {
+            int owner = layout.owner(config, x, y);
+            ASSERT_GE(owner, 0);
+            ASSERT_LT(owner, layout.count());
+            EXPECT_TRUE(layout.rect(config, owner).contains(x, y));
+        }
+    }
+}
+
+TEST(Shard, MatchesSingleProcess) {
+    WorldConfig config;
+    config.map_x = 200;
+    config.map_y = 150;
+    config.seed = 2024;
+
+    auto initial = random_population(config, 300);
+
+    World world(config);
+    for (const auto& body : initial)
+        world.add(body);
+    for (int t = 0; t < 40; ++t)
+        world.step();
+
+    auto sharded = run_sharded(config, ShardLayout{2, 2}, initial, 40);
+
+    ASSERT_EQ(sharded.size(), world.bodies().size());
+    for (std::size_t i = 0; i < sharded.size(); ++i) {
+        const Body& expected = world.bodies()[i];
+        EXPECT_EQ(sharded[i].id, expected.id);
+        EXPECT_EQ(sharded[i].x, expected.x);
+        EXPECT_EQ(sharded[i].y, expected.y);
+        EXPECT_EQ(sharded[i].alive, expected.alive);
+    }
+}
+
+TEST(Ensemble, IndependentOfThreadCount) {
+    EnsembleConfig config;
+    config.world.seed = 11;
+    config.runs = 64;
+    config.ticks = 100;
+
+    config.threads = 1;
+    EnsembleResult serial = run_ensemble(config);
+    config.threads = 4;
+    EnsembleResult parallel = run_ensemble(config);
+
+    EXPECT_EQ(serial.runs, 64);
+    EXPECT_EQ(serial.spawned, parallel.spawned);
+    EXPECT_EQ(serial.survived, parallel.survived);
+    EXPECT_EQ(serial.survivors, parallel.survivors);
+}
+
+TEST(Ensemble, PrincessesAloneAllSurvive) {
+    EnsembleConfig config;
+    config.mix = {0, 1, 0, 0};
+    config.runs = 16;
+    config.npcs = 10;
+
+    EnsembleResult result = run_ensemble(config);
+
+    EXPECT_DOUBLE_EQ(result.survival_rate(PrincessType), 1.0);
+    EXPECT_DOUBLE_EQ(result.extinction_rate(PrincessType), 0.0);
+    EXPECT_EQ(result.survivors[PrincessType][10], 16u);
+}
+
+TEST(Ensemble, RejectsBadMix) {
+    EnsembleConfig config;
+    config.runs = 2;
+
+    config.mix = {0, 0, 0, 0};
+    EXPECT_THROW(run_ensemble(config), std::runtime_error);
+    config.mix = {0, 2, -1, 1};
+    EXPECT_THROW(run_ensemble(config), std::runtime_error);
+    EXPECT_THROW(random_population(config.world, 10, {0, 0, 0, 0}), std::runtime_error);
+    EXPECT_THROW(split_counts(10, {0, 1, -1, 0}), std::runtime_error);
+}
+
+TEST(FightBatch, MatchesDuelStatistics) {
+    WorldConfig config;
+    config.seed = 3;
+
+    std::vector<Body> bodies;
+    std::vector<FightPair> pairs;
+    for (std::uint32_t i = 0; i < 2000; ++i) {
+        bodies.push_back({i, 0, 0, i % 2 ? DragonType : PrincessType, true});
+    }
+    for (std::uint32_t a = 1; a < 2000; a += 2)
+        for (std::uint32_t d = 0; d < 2000; d += 2)
+            pairs.push_back({a, d});
+
+    auto outcomes = resolve_fights(config, 0, bodies, pairs);
+
+    std::size_t wins = 0;
+    for (std::size_t i = 0; i < outcomes.size(); ++i) {
+        EXPECT_EQ(outcomes[i] != FightLost, attack_wins(config, 0, bodies[pairs[i].attacker], bodies[pairs[i].defender]));
+        wins += outcomes[i] != FightLost;
+    }
+
+    EXPECT_NEAR(static_cast<double>(wins) / outcomes.size(), 15.0 / 36.0, 0.005);
+}
+
+TEST(FightBatch, FirstWinnerClaimsDefender) {
+    WorldConfig config;
+    config.seed = 5;
+
+    std::vector<Body> bodies{{0, 0, 0, PrincessType, true}};
+    std::vector<FightPair> pairs;
+    for (std::uint32_t i = 1; i <= 40; ++i) {
+        bodies.push_back({100 - i, 0, 0, DragonType, true});
+        pairs.push_back({i, 0});
+    }
+
+    auto outcomes = resolve_fights(config, 0, bodies, pairs);
+
+    std::uint32_t expected = 1000;
+    for (std::size_t i = 0; i < pairs.size(); ++i)
+        if (outcomes[i] != FightLost)
+            expected = std::min(expected, bodies[pairs[i].attacker].id);
+
+    int killers = 0;
+    for (std::size_t i = 0; i < pairs.size(); ++i) {
+        if (outcomes[i] == FightKilled) {
+            ++killers;
+            EXPECT_EQ(bodies[pairs[i].attacker].id, expected);
+        }
+    }
+    EXPECT_EQ(killers, 1);
+}
+
+TEST(FightBatch, GroupsByTypePair) {
+    WorldConfig config;
+    std::vector<Body> bodies{
+        {0, 10, 10, PrincessType, true},
+        {1, 12, 10, DragonType, true},
+        {2, 14, 10, KnightType, true},
+        {3, 49, 49, KnightType, true}};
+
+    FightBatch batch = collect_fights(config, bodies, bodies.size());
+
+    ASSERT_EQ(batch.pairs.size(), 2u);
+    std::size_t dragon_princess = fight_group(DragonType, PrincessType);
+    std::size_t knight_dragon = fight_group(KnightType, DragonType);
+    EXPECT_EQ(batch.group_start[dragon_princess + 1] - batch.group_start[dragon_princess], 1u);
+    EXPECT_EQ(batch.group_start[knight_dragon + 1] - batch.group_start[knight_dragon], 1u);
+}
+
+TEST(FightBatch, GroupedMatchesFlat) {
+    WorldConfig config;
+    config.seed = 8;
+    config.map_x = 200;
+    config.map_y = 200;
+
+    auto bodies = random_population(config, 3000);
+    FightBatch batch = collect_fights(config, bodies, bodies.size());
+    ASSERT_GT(batch.pairs.size(), 0u);
+
+    EXPECT_EQ(resolve_fights(config, 4, bodies, batch), resolve_fights(config, 4, bodies, batch.pairs));
+}
+
+TEST(FrameFeed, ViewerSeesLatestFrame) {
+    WorldConfig config;
+    config.seed = 1;
+    World world(config);
+    for (const auto& body : random_population(config, 30))
+        world.add(body);
+
+    FramePublisher publisher("/hw7_test_frames", 30);
+    FrameSubscriber viewer("/hw7_test_frames");
+    ASSERT_TRUE(viewer.attached());
+    EXPECT_TRUE(viewer.publisher_open());
+
+    Frame frame;
+    EXPECT_FALSE(viewer.read(frame));
+
+    for (int t = 0; t < 10; ++t) {
+        world.step();
+        publisher.publish(world.tick(), world.config(), world.bodies());
+    }
+
+    ASSERT_TRUE(viewer.read(frame));
+    EXPECT_EQ(frame.tick, 10);
+    EXPECT_EQ(frame.number, 9u);
+    ASSERT_EQ(frame.bodies.size(), world.bodies().size());
+    for (std::size_t i = 0; i < frame.bodies.size(); ++i) {
+        EXPECT_EQ(frame.bodies[i].x, world.bodies()[i].x);
+        EXPECT_EQ(frame.bodies[i].alive, world.bodies()[i].alive);
+    }
+
+    EXPECT_FALSE(viewer.read(frame));
+}
+
+TEST(FrameFeed, ViewerWithoutPublisherIsDetached) {
+    FrameSubscriber viewer("/hw7_test_frames_missing");
+    Frame frame;
+    EXPECT_FALSE(viewer.attached());
+    EXPECT_FALSE(viewer.read(frame));
+}
+
+TEST(FrameFeed, NewPublisherReplacesStaleRing) {
+    WorldConfig config;
+    std::vector<Body> bodies(100);
+
+    // The first publisher stands in for one that crashed without closing the feed.
+    FramePublisher stale("/hw7_test_frames_stale", 10);
+    FrameSubscriber old_viewer("/hw7_test_frames_stale");
+    ASSERT_TRUE(old_viewer.attached());
+    stale.publish(1, config, bodies);
+
+    FramePublisher fresh("/hw7_test_frames_stale", 100);
+    fresh.publish(2, config, bodies);
+
+    Frame frame;
+    EXPECT_FALSE(old_viewer.publisher_open());
+    ASSERT_TRUE(old_viewer.read(frame));
+    EXPECT_EQ(frame.bodies.size(), 10u);
+
+    FrameSubscriber viewer("/hw7_test_frames_stale");
+    EXPECT_TRUE(viewer.publisher_open());
+    ASSERT_TRUE(viewer.read(frame));
+    EXPECT_EQ(frame.tick, 2);
+    EXPECT_EQ(frame.bodies.size(), 100u);
+}
+
+TEST(FrameFeed, ViewerRejectsRingLargerThanMapping) {
+    const char* name = "/hw7_test_frames_short";
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(ftruncate(fd, 4096), 0);
+    void* memory = mmap(nullptr, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(memory, MAP_FAILED);
+
+    auto* header = static_cast<FrameRingHeader*>(memory);
+    header->slots = 4;
+    header->capacity = 1000000;
+    header->open = 1;
+    header->latest = 1;
+    header->magic = 0x48573746;
+
+    FrameSubscriber viewer(name);
+    Frame frame;
+    ASSERT_TRUE(viewer.attached());
+    EXPECT_FALSE(viewer.read(frame));
+
+    munmap(memory, 4096);
+    shm_unlink(name);
+}
+
+TEST(Footprint, CompactBodyIsSmaller) {
+    EXPECT_LE(sizeof(Body), 16u);
+
+    Footprint npc = measure_npc_footprint(3000);
+    Footprint body = measure_body_footprint(3000);
+
+    EXPECT_EQ(body.object_bytes, sizeof(Body));
+    EXPECT_GT(npc.per_entity(), 4 * body.per_entity());
+}
+
+TEST(Footprint, NamesDerivedFromTypeAndId) {
+    Body body;
+    body.id = 17;
+    body.type = KnightType;
+    EXPECT_EQ(body_name(body), "Knight_17");
+}
+
+TEST(Checkpoint, ResumeContinuesDeterministically) {
+    std::string filename = "test_checkpoint.bin";
+    std::remove(filename.c_str());
+
+    WorldConfig config;
+    config.map_x = 120;
+    config.map_y = 120;
+    config.seed = 99;
+    auto initial = random_population(config, 200);
+
+    World reference(config);
+    for (const auto& body : initial)
+        reference.add(body);
+    for (int t = 0; t < 100; ++t)
+        reference.step();
+
+    {
+        World interrupted(config);
+        for (const auto& body : initial)
+            interrupted.add(body);
+
+        CheckpointWriter writer(filename, 25);
+        writer.record(interrupted);
+        for (int t = 0; t < 60; ++t) {
+            interrupted.step();
+            writer.record(interrupted);
+        }
+    }
+
+    World resumed = load_checkpoint(filename);
+    EXPECT_EQ(resumed.tick(), 60);
+    EXPECT_EQ(resumed.config().seed, 99u);
+    while (resumed.tick() < 100)
+        resumed.step();
+
+    ASSERT_EQ(resumed.bodies().size(), reference.bodies().size());
+    for (std::size_t i = 0; i < resumed.bodies().size(); ++i) {
+        EXPECT_EQ(resumed.bodies()[i].x, reference.bodies()[i].x);
+        EXPECT_EQ(resumed.bodies()[i].y, reference.bodies()[i].y);
+        EXPECT_EQ(resumed.bodies()[i].alive, reference.bodies()[i].alive);
+    }
+
+    std::remove(filename.c_str());
+}
+
+TEST(Checkpoint, TornTailIsIgnored) {
+    std::string filename = "test_checkpoint_torn.bin";
+    std::remove(filename.c_str());
+
+    WorldConfig config;
+    config.seed = 4;
+    World world(config);
+    for (const auto& body : random_population(config, 40))
+        world.add(body);
+
+    std::vector<Body> at_tick_9;
+    {
+        CheckpointWriter writer(filename, 100);
+        for (int t = 0; t < 10; ++t) {
+            world.step();
+            writer.record(world);
+            writer.flush();
+            if (world.tick() == 9)
+                at_tick_9 = world.bodies();
+        }
+    }
+
+    std::ifstream is(filename, std::ios::binary | std::ios::ate);
+    auto size = static_cast<std::size_t>(is.tellg());
+    is.close();
+    std::filesystem::resize_file(filename, size - 3);
+
+    World restored = load_checkpoint(filename);
+    EXPECT_EQ(restored.tick(), 9);
+    ASSERT_EQ(restored.bodies().size(), at_tick_9.size());
+    for (std::size_t i = 0; i < at_tick_9.size(); ++i)
+        EXPECT_EQ(restored.bodies()[i].x, at_tick_9[i].x);
+
+    std::remove(filename.c_str());
+}
+
+TEST(Checkpoint, BaseImageEveryInterval) {
+    std::string filename = "test_checkpoint_base.bin";
+    std::remove(filename.c_str());
+
+    WorldConfig config;
+    config.map_x = 2000;
+    config.map_y = 2000;
+    config.seed = 8;
+    World world(config);
+    for (const auto& body : random_population(config, 50000))
+        world.add(body);
+
+    // Recording every tick outpaces the writer, which may coalesce deltas but
+    // must still put each base image on disk.
+    {
+        CheckpointWriter writer(filename, 4);
+        for (int t = 0; t < 40; ++t) {
+            writer.record(world);
+            world.step();
+        }
+    }
+
+    // Record header: kind, tick, payload size.
+    std::ifstream is(filename, std::ios::binary);
+    std::vector<int> bases;
+    std::uint32_t kind;
+    std::int32_t tick;
+    std::uint64_t size;
+    while (is.read(reinterpret_cast<char*>(&kind), sizeof(kind)) && is.read(reinterpret_cast<char*>(&tick), sizeof(tick)) &&
+           is.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+        if (kind == 1)
+            bases.push_back(tick);
+        is.seekg(static_cast<std::streamoff>(size), std::ios::cur);
+    }
+    is.close();
+
+    std::vector<int> expected;
+    for (int t = 0; t < 40; t += 4)
+        expected.push_back(t);
+    EXPECT_EQ(bases, expected);
+
+    std::remove(filename.c_str());
+}
+
+TEST(Checkpoint, RejectsOutOfRangeDelta) {
+    std::string filename = "test_checkpoint_corrupt.bin";
+    std::remove(filename.c_str());
+
+    WorldConfig config;
+    config.seed = 6;
+    World world(config);
+    for (const auto& body : random_population(config, 40))
+        world.add(body);
+
+    {
+        CheckpointWriter writer(filename, 100);
+        writer.record(world);
+        writer.flush();
+        world.step();
+        writer.record(world);
+    }
+
+    // The delta is the last record: a 16-byte header, the move count, then the
+    // first MoveEntry, whose index is pointed past the bodies.
+    std::fstream fs(filename, std::ios::binary | std::ios::in | std::ios::out | std::ios::ate);
+    auto size = static_cast<std::streamoff>(fs.tellg());
+    std::uint32_t moves = 0;
+    std::streamoff delta = 0;
+    for (std::streamoff at = 0; at < size;) {
+        std::uint64_t record_size;
+        fs.seekg(at + 8);
+        fs.read(reinterpret_cast<char*>(&record_size), sizeof(record_size));
+        delta = at;
+        at += 16 + static_cast<std::streamoff>(record_size);
+    }
+    fs.seekg(delta + 16);
+    fs.read(reinterpret_cast<char*>(&moves), sizeof(moves));
+    ASSERT_GT(moves, 0u);
+    std::uint32_t bad = 1000000;
+    fs.seekp(delta + 20);
+    fs.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+    fs.close();
+
+    EXPECT_THROW(load_checkpoint(filename), std::runtime_error);
+    std::remove(filename.c_str());
+}
+
+TEST(FightLog, QueriesReadOnlyMatchingBlocks) {
+    std::string filename = "test_fights.bin";
+
+    std::vector<FightRecord> written;
+    {
+        FightLogWriter writer(filename, 100);
+        for (int i = 0; i < 1000; ++i) {
+            FightRecord r;
+            r.tick = i / 10;
+            r.attacker_id = static_cast<std::uint32_t>(i % 37);
+            r.attacker_type = KnightType;
+            r.attacker_x = i % 50;
+            r.attacker_y = (i * 7) % 50;
+            r.defender_id = static_cast<std::uint32_t>(1000 + i);
+            r.defender_type = DragonType;
+            r.defender_x = (i * 3) % 50;
+            r.defender_y = (i * 11) % 50;
+            r.outcome = FightKilled;
+            writer.add(r);
+            written.push_back(r);
+        }
+    }
+
+    FightLogReader reader(filename);
+    ASSERT_EQ(reader.blocks().size(), 10u);
+
+    auto first = reader.read_block(0);
+    ASSERT_EQ(first.size(), 100u);
+    EXPECT_EQ(first[42].defender_x, written[42].defender_x);
+    EXPECT_EQ(first[42].attacker_y, written[42].attacker_y);
+    EXPECT_EQ(first[42].defender_type, DragonType);
+
+    FightQuery by_ticks;
+    by_ticks.tick_from = 25;
+    by_ticks.tick_to = 34;
+    std::size_t found = 0;
+    std::size_t read = reader.query(by_ticks, [&](const FightRecord&) { ++found; });
+    EXPECT_EQ(found, 100u);
+    EXPECT_EQ(read, 2u);
+
+    FightQuery by_name;
+    EXPECT_FALSE(parse_body_name("Knight_x", by_name));
+    EXPECT_FALSE(parse_body_name("Knight_17x", by_name));
+    EXPECT_FALSE(parse_body_name("Wizard_17", by_name));
+    ASSERT_TRUE(parse_body_name("Knight_17", by_name));
+    found = 0;
+    reader.query(by_name, [&](const FightRecord& r) {
+        EXPECT_EQ(r.attacker_id, 17u);
+        ++found;
+    });
+    EXPECT_EQ(found, 27u);
+
+    FightQuery by_box;
+    by_box.box = std::array<std::int32_t, 4>{0, 0, 4, 4};
+    std::size_t expected = 0;
+    for (const auto& r : written)
+        expected += r.defender_x <= 4 && r.defender_y <= 4;
+    found = 0;
+    reader.query(by_box, [&](const FightRecord&) { ++found; });
+    EXPECT_EQ(found, expected);
+
+    std::remove(filename.c_str());
+}
+
+TEST(FightLog, RejectsCorruptBlockAndIndex) {
+    std::string filename = "test_fights_corrupt.bin";
+    {
+        FightLogWriter writer(filename, 10);
+        for (int i = 0; i < 20; ++i) {
+            FightRecord r;
+            r.tick = i;
+            r.attacker_id = static_cast<std::uint32_t>(i);
+            r.attacker_type = DragonType;
+            r.defender_id = static_cast<std::uint32_t>(100 + i);
+            r.defender_type = PrincessType;
+            writer.add(r);
+        }
+    }
+
+    // Continuation bits all over the first block: its varints never end inside it.
+    {
+        FightLogReader reader(filename);
+        ASSERT_EQ(reader.blocks().size(), 2u);
+        std::fstream fs(filename, std::ios::binary | std::ios::in | std::ios::out);
+        std::vector<char> garbage(reader.blocks()[0].bytes, static_cast<char>(0xff));
+        fs.write(garbage.data(), garbage.size());
+    }
+    {
+        FightLogReader reader(filename);
+        EXPECT_THROW(reader.read_block(0), std::runtime_error);
+        EXPECT_EQ(reader.read_block(1).size(), 10u);
+    }
+
+    // The footer's block count is the second field of the last 24 bytes.
+    {
+        std::fstream fs(filename, std::ios::binary | std::ios::in | std::ios::out | std::ios::ate);
+        std::uint64_t blocks = 1000000;
+        fs.seekp(-16, std::ios::end);
+        fs.write(reinterpret_cast<const char*>(&blocks), sizeof(blocks));
+    }
+    EXPECT_THROW(FightLogReader reader(filename), std::runtime_error);
+
+    std::remove(filename.c_str());
+}
+
+TEST(FightLog, RecordsWorldKills) {
+    std::string filename = "test_world_fights.bin";
+
+    WorldConfig config;
+    config.seed = 8;
+    int kills = 0;
+    {
+        World world(config);
+        for (const auto& body : random_population(config, 50))
+            world.add(body);
+        world.subscribe(std::make_shared<FightLogWriter>(filename));
+        for (int t = 0; t < 100; ++t)
+            world.step();
+        for (const auto& body : world.bodies())
+            kills += !body.alive;
+    }
+
+    FightLogReader reader(filename);
+    int logged = 0;
+    reader.query(FightQuery{}, [&](const FightRecord& r) {
+        EXPECT_TRUE(can_eat(r.attacker_type, r.defender_type));
+        ++logged;
+    });
+    EXPECT_EQ(logged, kills);
+
+    std::remove(filename.c_str());
+}
+
+TEST(RegionStats, ParallelMatchesSerial) {
+    WorldConfig config;
+    config.map_x = 1000;
+    config.map_y = 1000;
+    config.seed = 6;
+    auto bodies = random_population(config, 300000);
+    for (std::size_t i = 0; i < bodies.size(); i += 7)
+        bodies[i].alive = false;
+
+    RegionStats serial(config, 40, 30, 1);
+    RegionStats parallel(config, 40, 30, 4);
+    serial.update(bodies);
+    parallel.update(bodies);
+
+    std::uint64_t alive = 0;
+    for (const auto& body : bodies)
+        alive += body.alive;
+
+    EXPECT_EQ(serial.total(PrincessType) + serial.total(DragonType) + serial.total(KnightType), alive);
+    for (int cell = 0; cell < 40 * 30; ++cell)
+        for (NpcType type : {PrincessType, DragonType, KnightType})
+            ASSERT_EQ(serial.count(cell, type), parallel.count(cell, type));
+}
+
+TEST(RegionStats, CountsKillsAndRatios) {
+    WorldConfig config;
+    RegionStats stats(config, 5, 5, 1);
+
+    std::vector<Body> bodies{
+        {0, 1, 1, PrincessType, true},
+        {1, 2, 2, PrincessType, true},
+        {2, 3, 3, DragonType, true},
+        {3, 49, 49, KnightType, true}};
+    stats.update(bodies);
+    stats.on_kill(0, bodies[2], bodies[0]);
+
+    int corner = stats.cell_of(0, 0);
+    EXPECT_EQ(stats.count(corner, PrincessType), 2u);
+    EXPECT_EQ(stats.kills(corner), 1u);
+    EXPECT_DOUBLE_EQ(stats.predator_prey_ratio(corner), 1.0 / 3.0);
+    EXPECT_EQ(stats.dominant(corner), PrincessType);
+    EXPECT_EQ(stats.dominant(stats.cell_of(49, 49)), KnightType);
+    EXPECT_EQ(stats.dominant(stats.cell_of(25, 25)), Unknown);
+
+    std::stringstream ss;
+    draw_regions(ss, stats, bodies.size());
+    EXPECT_NE(ss.str().find("\033[35mP\033[0m"), std::string::npos);
+    EXPECT_NE(ss.str().find("Всего: 4/4"), std::string::npos);
+}
+
+TEST(Activity, PreyFarFromPredatorsSleeps) {
+    WorldConfig config;
+    config.map_x = 2000;
+    config.map_y = 2000;
+
+    std::vector<Body> bodies{
+        {0, 10, 10, PrincessType, true},
+        {1, 12, 10, PrincessType, true},
+        {2, 1900, 1900, DragonType, true}};
+    RegionActivity activity(config, {50, 8});
+    activity.rebuild(bodies);
+    EXPECT_FALSE(activity.is_awake(0));
+    EXPECT_EQ(activity.sleeping(), activity.regions());
+
+    bodies.push_back({3, 60, 60, DragonType, true});
+    EXPECT_FALSE(activity.tracks(bodies));
+    EXPECT_TRUE(activity.is_awake(3));
+
+    activity.rebuild(bodies);
+    EXPECT_TRUE(activity.is_awake(0));
+    EXPECT_EQ(activity.sleeping(), activity.regions() - 1);
+
+    bodies[3].x = bodies[3].y = 1000;
+    activity.relocate(3, bodies[3]);
+    activity.refresh();
+    EXPECT_FALSE(activity.is_awake(0));
+}
+
+TEST(Activity, SingleRegionMatchesPlainRun) {
+    WorldConfig config;
+    config.seed = 9;
+
+    World plain(config), sleepy(config);
+    for (const auto& body : random_population(config, 60)) {
+        plain.add(body);
+        sleepy.add(body);
+    }
+    sleepy.enable_sleeping({config.map_x + 1, 8});
+
+    // With one region the whole map sleeps only once no fight can happen anywhere,
+    // so kills always match and positions match until then.
+    for (int t = 0; t < 50; ++t) {
+        plain.step();
+        sleepy.step();
+
+        ASSERT_EQ(plain.bodies().size(), sleepy.bodies().size());
+        for (std::size_t i = 0; i < plain.bodies().size(); ++i) {
+            ASSERT_EQ(plain.bodies()[i].alive, sleepy.bodies()[i].alive);
+            if (sleepy.sleeping_regions() == 0) {
+                ASSERT_EQ(plain.bodies()[i].x, sleepy.bodies()[i].x);
+                ASSERT_EQ(plain.bodies()[i].y, sleepy.bodies()[i].y);
+            }
+        }
+    }
+}
+
+TEST(Activity, ResumeWithSleepingMatches) {
+    std::string filename = "test_checkpoint_sleeping.bin";
+    std::remove(filename.c_str());
+
+    WorldConfig config;
+    config.map_x = 2000;
+    config.map_y = 2000;
+    config.seed = 7;
+    SleepConfig sleep{100, 8};
+    auto initial = random_population(config, 3000, {0, 20, 1, 1});
+
+    World reference(config);
+    for (const auto& body : initial)
+        reference.add(body);
+    reference.enable_sleeping(sleep);
+    for (int t = 0; t < 100; ++t)
+        reference.step();
+    EXPECT_GT(reference.sleeping_regions(), 0u);
+
+    {
+        World interrupted(config);
+        for (const auto& body : initial)
+            interrupted.add(body);
+        interrupted.enable_sleeping(sleep);
+
+        CheckpointWriter writer(filename, 25);
+        for (int t = 0; t < 63; ++t) {
+            interrupted.step();
+            writer.record(interrupted);
+        }
+    }
+
+    World resumed = load_checkpoint(filename);
+    resumed.enable_sleeping(sleep);
+    while (resumed.tick() < 100)
+        resumed.step();
+
+    ASSERT_EQ(resumed.bodies().size(), reference.bodies().size());
+    for (std::size_t i = 0; i < resumed.bodies().size(); ++i) {
+        ASSERT_EQ(resumed.bodies()[i].x, reference.bodies()[i].x);
+        ASSERT_EQ(resumed.bodies()[i].y, reference.bodies()[i].y);
+        ASSERT_EQ(resumed.bodies()[i].alive, reference.bodies()[i].alive);
+    }
+
+    std::remove(filename.c_str());
+}
+
+TEST(Activity, DozingDriftsOnlySkippedSteps) {
+    WorldConfig config;
+    config.map_x = 1000000;
+    config.map_y = 1000000;
+    config.seed = 3;
+    int stride = 8;
+    int ticks = 64;
+
+    std::vector<Body> bodies(20000);
+    for (std::size_t i = 0; i < bodies.size(); ++i)
+        bodies[i] = {static_cast<std::uint32_t>(i), 500000, 500000, DragonType, true};
+
+    // Bodies fall asleep and wake up at random, often in the middle of a stride.
+    for (int t = 0; t < ticks; ++t) {
+        for (auto& body : bodies) {
+            if (roll(11, t, body.id, 0) % 3) {
+                doze_body(body, config, t, stride, body.id);
+            } else {
+                wake_body(body, config, t, stride, body.id);
+                move_body(body, config, t);
+            }
+        }
+    }
+    for (auto& body : bodies)
+        wake_body(body, config, ticks, stride, body.id);
+
+    double msd = 0;
+    for (const auto& body : bodies) {
+        double dx = body.x - 500000;
+        double dy = body.y - 500000;
+        msd += (dx * dx + dy * dy) / bodies.size();
+    }
+
+    int d = NpcRegistry::speed[DragonType];
+    double expected = 2.0 * ticks * d * (d + 1) / 3.0;
+    EXPECT_NEAR(msd / expected, 1.0, 0.03);
+}
+
+TEST(Activity, BodiesAddedWhileSleepingAreTracked) {
+    WorldConfig config;
+    config.map_x = 2000;
+    config.map_y = 2000;
+
+    World world(config);
+    for (const auto& body : random_population(config, 10))
+        world.add(body);
+    world.enable_sleeping({50, 8});
+    world.step();
+
+    for (const auto& body : random_population(config, 1000))
+        world.add(body);
+    world.step();
+    EXPECT_EQ(world.tick(), 2);
+}
+
+TEST(Spawn, ThreadCountDoesNotChangeResult) {
+    WorldConfig config;
+    config.seed = 5;
+    config.map_x = 1000;
+    config.map_y = 1000;
+
+    SpawnPlan plan;
+    plan.counts = split_counts(300000, {0, 2, 1, 1});
+    plan.placement = Placement::Clustered;
+
+    World serial(config), parallel(config);
+    serial.spawn(KnightType, 0, 0);
+    parallel.spawn(KnightType, 0, 0);
+    plan.threads = 1;
+    bulk_spawn(serial, plan);
+    plan.threads = 4;
+    bulk_spawn(parallel, plan, std::make_shared<RegionStats>(config, 4, 4));
+
+    ASSERT_EQ(serial.bodies().size(), 300001u);
+    ASSERT_EQ(parallel.bodies().size(), 300001u);
+    for (std::size_t i = 0; i < serial.bodies().size(); ++i) {
+        ASSERT_EQ(serial.bodies()[i].id, i);
+        ASSERT_EQ(serial.bodies()[i].x, parallel.bodies()[i].x);
+        ASSERT_EQ(serial.bodies()[i].y, parallel.bodies()[i].y);
+        ASSERT_EQ(serial.bodies()[i].type, parallel.bodies()[i].type);
+    }
+
+    auto alive = serial.alive_by_type();
+    EXPECT_EQ(alive[PrincessType], 150000);
+    EXPECT_EQ(alive[DragonType], 75000);
+    EXPECT_EQ(alive[KnightType], 75001);
+}
+
+TEST(Spawn, FromFileCyclesPoints) {
+    std::string path = "test_points.txt";
+    {
+        std::ofstream os(path);
+        os << "1 2\n10 20\n100 200\n";
+    }
+
+    WorldConfig config;
+    SpawnPlan plan;
+    plan.counts = {0, 4, 0, 1};
+    plan.placement = Placement::FromFile;
+    plan.file = path;
+
+    World world(config);
+    bulk_spawn(world, plan);
+    std::remove(path.c_str());
+
+    ASSERT_EQ(world.bodies().size(), 5u);
+    EXPECT_EQ(world.bodies()[1].x, 10);
+    EXPECT_EQ(world.bodies()[3].y, 2);
+    EXPECT_EQ(world.bodies()[2].x, 50);
+    EXPECT_EQ(world.bodies()[2].y, 50);
+    EXPECT_EQ(world.bodies()[4].type, KnightType);
+
+    plan.file = "missing_points.txt";
+    EXPECT_THROW(bulk_spawn(world, plan), std::runtime_error);
+}
+
+TEST(Spawn, RejectsUnknownTypeAndPlacement) {
+    WorldConfig config;
+    SpawnPlan plan;
+    plan.counts = {3, 2, 0, 0};
+
+    World world(config);
+    EXPECT_THROW(bulk_spawn(world, plan), std::runtime_error);
+    EXPECT_TRUE(world.bodies().empty());
+
+    EXPECT_EQ(placement_from_name("clusters"), Placement::Clustered);
+    EXPECT_THROW(placement_from_name("gaussian"), std::runtime_error);
+}
+
+TEST(Registry, TablesFollowTraits) {
+    static_assert(NpcRegistry::size == 4);
+    static_assert(NpcRegistry::max_reach == 30);
+    static_assert(NpcRegistry::eats[DragonType][PrincessType]);
+    static_assert(!NpcRegistry::eats[PrincessType][DragonType]);
+    static_assert(NpcRegistry::types == std::array{PrincessType, DragonType, KnightType});
+    static_assert(EvenMix == PopulationMix{0, 1, 1, 1});
+
+    EXPECT_EQ(move_distance(KnightType), NpcTraits<Knight>::speed);
+    EXPECT_EQ(kill_distance(DragonType), NpcTraits<Dragon>::reach);
+    EXPECT_EQ(symbol(Unknown), '?');
+    EXPECT_EQ(type_name(Unknown), "Unknown");
+    EXPECT_TRUE(NpcRegistry::predator[KnightType]);
+    EXPECT_FALSE(NpcRegistry::predator[PrincessType]);
+    EXPECT_TRUE(NpcRegistry::prey[DragonType]);
+    EXPECT_FALSE(NpcRegistry::prey[KnightType]);
+    EXPECT_EQ(NpcRegistry::column[DragonType], "dragons");
+    EXPECT_EQ(NpcRegistry::title[Unknown], "Неизвестные");
+
+    std::ostringstream header;
+    RegionStats::export_csv_header(header);
+    EXPECT_EQ(header.str(), "tick,gx,gy,princesses,dragons,knights,kills,predator_prey_ratio\n");
+
+    auto npc = NpcRegistry::make(DragonType, "Dragon", 3, 4);
+    ASSERT_NE(std::dynamic_pointer_cast<Dragon>(npc), nullptr);
+    EXPECT_EQ(npc->position(), std::make_pair(3, 4));
+    EXPECT_EQ(NpcRegistry::make(Unknown, "Nobody", 0, 0), nullptr);
+}
+
+TEST(Registry, OnlyPreyCanBeAttacked) {
+    auto mock = std::make_shared<MockObserver>();
+    auto princess = std::make_shared<Princess>("Princess", 0, 0);
+    auto dragon = std::make_shared<Dragon>("Dragon", 0, 0);
+    auto knight = std::make_shared<Knight>("Knight", 0, 0);
+    princess->subscribe(mock);
+    dragon->subscribe(mock);
+
+    EXPECT_FALSE(dragon->accept(princess));
+    EXPECT_FALSE(knight->accept(dragon));
+    EXPECT_FALSE(princess->attack(knight));
+    EXPECT_FALSE(dragon->attack(knight));
+    EXPECT_FALSE(mock->called);
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,63 @@
+/*
+    Просмотр симуляции из отдельного процесса.
+    Читает кадры из общей памяти (HW7_VAR6 --feed /hw7_frames) и рисует карту.
+    Можно подключаться и отключаться в любой момент, симуляция никого не ждёт.
+
+    HW7_VAR6_viewer [имя] [размер сетки]
+*/
+
+#include "frame_feed.h"
+#include "region_stats.h"
+
+#include <thread>
+#include <chrono>
+#include <csignal>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+volatile std::sig_atomic_t stop = 0;
+
+void draw_frame(const Frame& frame, int grid) {
+    WorldConfig config;
+    config.map_x = frame.map_x;
+    config.map_y = frame.map_y;
+
+    RegionStats stats(config, grid, grid);
+    stats.update(frame.bodies);
+
+    std::cout << "\033[H\033[2J" << "Тик " << frame.tick << " (кадр " << frame.number << ")";
+    draw_regions(std::cout, stats, frame.bodies.size());
+    std::cout.flush();
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::string name = argc > 1 ? argv[1] : "/hw7_frames";
+    int grid = argc > 2 ? std::stoi(argv[2]) : 25;
+
+    std::signal(SIGINT, [](int) { stop = 1; });
+
+    Frame frame;
+    while (!stop) {
+        FrameSubscriber feed(name);
+        if (!feed.attached()) {
+            std::this_thread::sleep_for(200ms);
+            continue;
+        }
+
+        while (!stop && feed.publisher_open()) {
+            if (feed.read(frame))
+                draw_frame(frame, grid);
+            std::this_thread::sleep_for(50ms);
+        }
+
+        if (!stop)
+            std::cout << "Симуляция завершилась, ожидание новой..." << "\n";
+        std::this_thread::sleep_for(200ms);
+    }
+
+    return 0;
+}